@@ -43,8 +43,8 @@ typedef pair<int, bool> WordAndPresence;
 class           Bchart : public ChartBase
 {
 public:
-  Bchart(SentRep& sentence,int id);
-  Bchart(SentRep& sentence,ExtPos& extPos,int id);
+  Bchart(SentRep& sentence,ParserContext& ctx);
+  Bchart(SentRep& sentence,ExtPos& extPos,ParserContext& ctx);
     virtual ~Bchart();
     virtual double  parse();
     static int&      printDebug() { return printDebug_; }
@@ -65,9 +65,6 @@ public:
     static map< ECString, WordAndPresence, less<ECString> > wordMap;
     static ECString invWordMap[MAXNUMWORDS];
   static int lastKnownWord;
-  static int lastWord[MAXNUMTHREADS];
-  static map<ECString, int> newWordMap[MAXNUMTHREADS];
-  static vector<ECString> newWords[MAXNUMTHREADS];
   static UnitRules*  unitRules; 
   static bool caseInsensitive;
   static bool tokenize;
@@ -128,6 +125,8 @@ public:
     void            add_starter_edges(Item* itm);
     float           meEdgeProb(const Term* trm, Edge* edge, int whichInt);
     float           meFHProb(const Term* trm, FullHist& fh, int whichInt);
+    float           meFHProbVals(int cVal, FullHist& fh, const int* vals,
+				 int whichInt);
     static int printDebug_;
 
     void            extend_rule(Edge* rule, Item * itm, int right);
@@ -165,11 +164,11 @@ public:
     void   addToDemerits(Edge* edge);
     static Item*    stops[MAXSENTLEN];
     EdgeHeap*       heap;
-    int             alreadyPoppedNum;
-    Edge*           alreadyPopped[450000]; //was 350000;
+    vector<Edge*>&  alreadyPopped;
     static int&     posStarts(int i, int j);
     static int      posStarts_[MAXNUMNTTS][MAXNUMNTS];
-  int     curDemerits_[MAXSENTLEN][MAXSENTLEN];
+  int&    curDemerits(int st, int ed)
+            { return cells_.demerits[cells_.span(st, ed)]; }
 
   static int egtSize_;
   static float bucketLims[14];
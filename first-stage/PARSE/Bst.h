@@ -34,13 +34,17 @@ typedef shorts::iterator shortIter;
 class Val
 {
  public:
-  static Val* newIth(int ith, Val* oval, bool& stop);
+  static Val* newIth(int ith, Val* oval, bool& stop, ParseArena& arena);
   Val() : status(NORMALVAL), len_(1), prob_(0), edge_(NULL), trm_(-1), wrd_(-1)
     {
       vec_.push_back(0);
     }
   Val(Edge* e, double prb);
   ~Val();
+  /* Vals live in their chart's ParseArena, see ParseArena.h */
+  void* operator new(size_t sz, ParseArena& arena) { return arena.alloc(sz); }
+  void  operator delete(void* p, ParseArena& arena) {}
+  void  operator delete(void* p) {}
   Edge* edge() const { return edge_; }
   Bsts& bsts() { return bsts_; }
   short  len() const { return len_; }
@@ -76,7 +80,7 @@ class Bst
  public:
   Bst() : explored_(false), done_(false), num_(0), sum_(0) {}
   ~Bst();
-  Val* next(int n);
+  Val* next(int n, ParseArena& arena);
   bool explored() const { return explored_; }
   bool& explored() { return explored_; }
   Val* nth(int i) { return nbest[i]; }
@@ -21,6 +21,7 @@
 #include "Item.h"
 #include "SentRep.h"
 #include "Feature.h"
+#include "ParserContext.h"
 #include <vector>
 
 class InputTree;
@@ -28,7 +29,7 @@ class InputTree;
 class           ChartBase
 {
 public:
-  ChartBase(SentRep& sentence,int id);
+  ChartBase(SentRep& sentence,ParserContext& context);
     virtual ~ChartBase();
 
     enum Err { OK, OVERFLW, FAILURE };
@@ -39,7 +40,7 @@ public:
     // extracting information about the parse.
     void            set_Alphas();
     const Items&    items( int i, int j ) const
-		    {   return regs[ i ][ j ];   }
+		    {   return regs( i, j );   }
     int             edgeCount() const    { return ruleiCounts_; }
     int             poppedEdgeCount() const    { return poppedEdgeCount_; }
     int             poppedEdgeCountAtS() const    { return poppedEdgeCountAtS_; }
@@ -50,7 +51,7 @@ public:
     static bool finalPunc(const char* wrd);
 
     Item*           topS() { return get_S(); }
-    int    thrdid;
+    ParserContext&  ctx;     // per-parse state, see ParserContext.h
     static int&	    ruleCountTimeout()  {   return ruleiCountTimeout_;   }
     static const double
 		    badParse;	// error return value for parse(), crossEntropy
@@ -59,19 +60,24 @@ public:
     int             effEnd(int pos);
     static float endFactor;
     static float midFactor;
-    static int      numItemsToDelete[MAXNUMTHREADS];
-    static int      itemsToDeletesize[MAXNUMTHREADS];
-    static vector<Item*>    itemsToDelete[MAXNUMTHREADS];
-    static bool     guided;
+    bool            guided;  // only build constituents in the guide
     void            setGuide(InputTree* tree);
     void            addConstraint(int start, int end, int term);
 protected:
     Item           *get_S() const;  
-    Items           regs[MAXSENTLEN][MAXSENTLEN];
-    vector<short>   guide[MAXSENTLEN][MAXSENTLEN];
+    /* regs(j, i) holds the items of length j+1 starting at i */
+    Items&          regs(int j, int i) const
+                      { return cells_.regs[cells_.span(i, i+j+1)]; }
+    vector<short>&  guide(int st, int ed)
+                      { return cells_.guide[cells_.span(st, ed)]; }
     bool            inGuide(int st, int ed, int trm);
     bool            inGuide(Edge* e);
-    list<Edge*>     waitingEdges[2][MAXSENTLEN];
+    Edges&          waitingEdges(int right, int pos)
+                      { return cells_.waitingEdges[right][pos]; }
+    ChartCells&     cells_;
+public:
+    ParseArena&     arena;   // holds this chart's Edges and Vals
+protected:
     double          crossEntropy_;
     int             wrd_count_;
     int             poppedEdgeCount_;
@@ -87,8 +93,6 @@ protected:
     float           endFactorComp(Edge* dnrl);
 
 private:
-    void            free_chart_items(Items& itms);
-    void            free_chart_itm(Item * itm);
     void            free_edges(list<Edge*>& edges);
 };
 
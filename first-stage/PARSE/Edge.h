@@ -19,6 +19,7 @@
 
 #include "Term.h"
 #include "utils.h"
+#include "ParseArena.h"
 
 class Item;
 
@@ -34,8 +35,13 @@ public:
 
     Edge( const Edge& src ) { error("edge copying no longer exists"); }
 
-    Edge() : num_(-1) {}
+    Edge() : num_(-1), lrItems_(NULL), lrSize_(0) {}
     ~Edge();
+    /* Edges live in their chart's ParseArena, see ParseArena.h */
+    void*           operator new(size_t sz, ParseArena& arena)
+		      { return arena.alloc(sz); }
+    void            operator delete(void* p, ParseArena& arena) {}
+    void            operator delete(void* p) {}
     bool            check(); 
 
     int 	    operator== (const Edge& rhs) { return this == &rhs; }
@@ -80,6 +86,10 @@ public:
     void            setFinishedParent( Item* par )
                       { finishedParent_ = par ; }
     Item           *finishedParent() { return finishedParent_; }
+    /* the edge's items left to right, NULL until a LeftRightGotIter
+       built with the chart's arena caches them */
+    Item**          lrItems() const { return lrItems_; }
+    short           lrSize() const { return lrSize_; }
     int            ccInd();
     static int      numEdges;
     static float    DemFac;
@@ -93,6 +103,8 @@ private:
     short           num_;
     short           status_; 
     Item           *item_;
+    Item          **lrItems_;
+    short           lrSize_;
     int             heapPos_;
     int             demerits_;
 
@@ -17,9 +17,30 @@
 #ifndef EDGEHEAP_H 
 #define EDGEHEAP_H
 
-#define HeapSize 370000
+#include <vector>
+#include "ECString.h"
+
 class Edge;
 
+/* The agenda.  Each entry keeps a copy of its edge's merit next to the
+   pointer so that sifting compares entries in the array itself rather
+   than chasing every Edge.  An edge's merit must not change while it
+   is on the heap; del() it, reset the merit, and insert() it again.
+
+   EDGEHEAP_ARITY is the number of children per node.  Edges with equal
+   merits may pop in a different order under another arity, which can
+   change the parses; time-edgeheap.C measures the arities. */
+
+#ifndef EDGEHEAP_ARITY
+#define EDGEHEAP_ARITY 2
+#endif
+
+struct HeapEntry
+{
+  double merit;
+  Edge*  edge;
+};
+
 class           EdgeHeap
 {
 public:
@@ -28,19 +49,17 @@ public:
   void    insert(Edge* edge);
   Edge*   pop();
   void    del(Edge* edge);
-  Edge**  ar() { return array; }
-  int     size() { return unusedPos_; }
+  int     size() { return array.size(); }
   //void    check();
   bool print;
 private:
   void  del_(int pos);
   void  downHeap(int pos);
   bool  upheap(int pos);
-  int   left_child(int par) const { return (par*2) + 1; }
-  int   right_child(int par) const { return ((par*2) + 2); }
-  int   parent(int child) const { return ((child-1)/2); }
-  int   unusedPos_;
-  Edge* array[HeapSize];
+  void  place(int pos, const HeapEntry& ent);
+  int   first_child(int par) const { return (par*EDGEHEAP_ARITY) + 1; }
+  int   parent(int child) const { return ((child-1)/EDGEHEAP_ARITY); }
+  vector<HeapEntry> array;
 };
 
 
@@ -23,28 +23,43 @@
 class Feat;
 class FeatureTree;
 
+/* Both arrays are kept sorted by ind() and searched by bisection.  Once
+   the model is loaded they can be flatten()ed: the keys are copied into
+   a separate int array in Eytzinger (breadth-first) order, so a lookup
+   walks a few adjacent cache lines of ints instead of probing structs
+   scattered over the whole array.  FBinaryArray also splits its Feats
+   into parallel keys_/gs_ arrays and drops array_; FTreeBinaryArray
+   permutes its subtrees into the same order as its keys. */
+
 class FBinaryArray
 {
  public:
-  FBinaryArray() : size_(0) {}
+  FBinaryArray() : size_(0), array_(NULL), keys_(NULL), gs_(NULL) {}
   void set(int sz);
+  void flatten();
   Feat*   find(const int id) const;
+  float*  findG(const int id) const;
   int     size() const { return size_; }
   Feat*   index(int i);
+  int     key(int i) const;
   int size_;
   Feat* array_;
+  int* keys_;
+  float* gs_;
 };
 
 class FTreeBinaryArray
 {
  public:
-  FTreeBinaryArray() : size_(0) {}
+  FTreeBinaryArray() : size_(0), array_(NULL), keys_(NULL) {}
   void set(int sz);
+  void flatten();
   FeatureTree*   find(const int id) const;
   int     size() const { return size_; }
   FeatureTree*   index(int i);
   int size_;
   FeatureTree* array_;
+  int* keys_;
 };
 
 #endif /* ! FBINARYARRAY_H */
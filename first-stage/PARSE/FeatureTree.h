@@ -54,7 +54,9 @@ public:
   void read(istream& is, FTypeTree* ftt);
   int  readOneLevel0(istream& is, int c);
   FeatureTree* follow(int val, int auxCnt);
+  void         flatten();
   static FeatureTree* roots(int which) { return roots_[which]; }
+  static bool  flatLayout;  // flatten() the trees once they are read
   void         printFfCounts(int asVal, int depth, ostream& os);
   friend ostream&  operator<<(ostream& os, const FeatureTree& ft);
 
@@ -67,6 +69,7 @@ public:
    FBinaryArray feats;
   FTreeBinaryArray subtree;
  private:
+  friend class ModelImage;
   static FeatureTree* roots_[20];
   void othReadFeatureTree(istream& is, FTypeTree* ftt, int cnt);
   void printFfCounts2(int asVal, int depth, ostream& os);
@@ -34,13 +34,19 @@ class           LeftRightGotIter
 {
  public:
   LeftRightGotIter(Edge* edge);
+  /* for an edge just made from its pred by adding one item on the
+     right (or left).  Builds the sequence from the pred's cached one
+     and caches it on the edge in the arena, so extending an edge does
+     not rewalk its whole pred chain. */
+  LeftRightGotIter(Edge* edge, int right, ParseArena& arena);
   bool    next(Item*& itm);
-  Item*   index(int i) const { assert(i < 400); return lrarray[i]; }
+  Item*   index(int i) const { assert(i < size_); return lrarray[i]; }
   int     size() const { return size_; }
   int&    pos() { return pos_; }
  private:
   void         makelrgi(Edge* edge);
-  Item*        lrarray[400];
+  Item**       lrarray;
+  Item*        local_[400];
   int          pos_;
   int          size_;
 };
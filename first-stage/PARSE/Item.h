@@ -74,6 +74,7 @@ public:
     Bst&              stored(CntxArray& ca) { return bstFind(ca, stored_); }
     PosMap&          posAndheads() { return posAndheads_; }
     void            set(const Term * _term, int _start);
+    void            releaseBsts() { stored_.clear(); posAndheads_.clear(); }
     void	    operator= (const Item& itm);
  private:
     int             start_;
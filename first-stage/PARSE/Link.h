@@ -19,6 +19,7 @@
 #include "ECString.h"
 
 class InputTree;
+class Val;
 
 #define DUMMYVAL 999
 
@@ -36,6 +37,9 @@ class Link
       for( ; li != links_.end() ; li++) delete (*li);
     }
   Link* is_unique(InputTree* tree, bool& ans, int& cnt);
+  /* same as above, but reads the parse straight from the chart's
+     back-pointers so duplicates never need an InputTree built */
+  Link* is_unique(Val* val, bool& ans, int& cnt);
   short key() const { return key_; }
  private:
   Link* do_link(int tint, bool& ans);
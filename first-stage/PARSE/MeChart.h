@@ -27,10 +27,10 @@
 class MeChart : public Bchart
 {
  public:
-  MeChart(SentRep & sentence,int id)
-    : Bchart( sentence,id ) {}
-  MeChart(SentRep & sentence,ExtPos& extpos,int id)
-    : Bchart( sentence,extpos,id ){}
+  MeChart(SentRep & sentence,ParserContext& ctx)
+    : Bchart( sentence,ctx ) {}
+  MeChart(SentRep & sentence,ExtPos& extpos,ParserContext& ctx)
+    : Bchart( sentence,extpos,ctx ){}
   double triGram();
   static void init(ECString path);
   Bst& findMapParse();
@@ -48,6 +48,7 @@ class MeChart : public Bchart
   Bst& recordedBPGH(Item* itm, BstMap& atm, FullHist* h);
   float meHeadProb(int wInt, FullHist* h);
   float meProb(int val, FullHist* h, int which);
+  float meProbVals(int val, FullHist* h, const int* vals, int which);
   float meRuleProb(Edge* e, FullHist* h);
   void  getRelFeats(int c, int c2, int which, Feat* relFeat[],
 		    FeatureTree* fts[], FullHist* h, int facPos);
@@ -0,0 +1,54 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef MODELIMAGE_H
+#define MODELIMAGE_H
+
+#include "ECString.h"
+#include "Feature.h"
+
+/* A compiled model image holds the FeatureTree forest (one tree per
+   calc type, with its FBinaryArray/FTreeBinaryArray children) plus the
+   lambdas and logFacs in a single flat file.  The trees are stored in
+   whichever layout FeatureTree::flatLayout selected when the image was
+   written, and an image in the other layout is ignored.  The image is written by
+   compileModel after the text model has been loaded and is mmap'ed
+   read-only by MeChart::init, so the tree nodes are used in place and
+   all processes on a host share one page-cache copy of the model.
+   The image also records the sizes and modification times of the .g
+   and .lambdas files it was made from; if they have changed since,
+   the image is ignored and the text files are read instead.
+
+   Pointers inside the image are stored as absolute addresses relative
+   to a preferred base address.  When the mapping lands there the image
+   is used as is; otherwise it is mapped privately and relocated.
+
+   featInfo.*, the term tables and the word map are small (or are STL
+   containers) and are still read from the text files. */
+
+#define MODELIMAGE_NAME "compiledModel.bin"
+
+class ModelImage
+{
+ public:
+  static bool write(ECString path, ECString fileName);
+  static bool load(ECString path);
+  static bool use;          // set to false to force the text model
+  static bool loaded() { return base_ != NULL; }
+ private:
+  static char* base_;
+  static size_t size_;
+};
+
+#endif /* ! MODELIMAGE_H */
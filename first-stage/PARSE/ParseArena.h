@@ -0,0 +1,56 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef PARSEARENA_H
+#define PARSEARENA_H
+
+#include <stddef.h>
+#include <vector>
+#include "ECString.h"
+
+/* ParseArena is a bump allocator for the Edges and Vals a chart creates
+   while parsing one sentence.  They are never freed one at a time (their
+   operator delete is a no-op, though their destructors still run);
+   instead the chart resets its arena when it is destroyed, which makes
+   the whole sentence's worth of memory available again in O(1).  The
+   blocks are kept for the next sentence.  Each ParserContext has its
+   own arena, so there is no allocator contention between parsing
+   threads. */
+
+#define ARENABLOCKSIZE (1 << 20)
+#define ARENAALIGN 16
+
+class ParseArena
+{
+ public:
+  ParseArena() : cur_(0), top_(ARENABLOCKSIZE) {}
+  ~ParseArena();
+  void*  alloc(size_t sz)
+    {
+      sz = (sz + ARENAALIGN - 1) & ~(size_t)(ARENAALIGN - 1);
+      if(top_ + sz > ARENABLOCKSIZE) return grow(sz);
+      void* ans = blocks_[cur_] + top_;
+      top_ += sz;
+      return ans;
+    }
+  void   reset();
+  size_t capacity() const { return blocks_.size() * ARENABLOCKSIZE; }
+ private:
+  void*  grow(size_t sz);
+  vector<char*> blocks_;
+  size_t cur_;   // block we are allocating from
+  size_t top_;   // first free byte in it
+};
+
+#endif /* ! PARSEARENA_H */
@@ -0,0 +1,47 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef PARSELOOP_H
+#define PARSELOOP_H
+
+#include <iostream>
+#include <vector>
+#include "ECString.h"
+#include "InputTree.h"
+#include "Params.h"
+#include "ewDciTokStrm.h"
+
+/* The parses of one sentence.  trees and probs hold the numDiff
+   distinct parses, best first; a sentence that could not be parsed
+   gets a single flat tree. */
+typedef struct printStruct{
+  int                sentenceCount;
+  size_t             numDiff;
+  vector<InputTree*> trees;
+  vector<double>     probs;
+  string             name;
+  string             lmScores;  // -M output, printed before the parses
+} printStruct;
+
+/* Parses everything in the input (from tokens if Bchart::tokenize is
+   set, from text otherwise) with numThreads workers, reading window
+   sentences at a time.  Each sentence is passed to output in input
+   order, which then owns its trees.  output is called from the worker
+   threads, never from two at once; while it blocks the workers keep
+   parsing until the reorder buffer is full, and then the reader waits
+   too.  Returns when every sentence has been output. */
+void parseLoop(Params& params, ewDciTokStrm* tokens, istream* text,
+	       int numThreads, size_t window, void (*output)(printStruct&));
+
+#endif /* ! PARSELOOP_H */
@@ -0,0 +1,86 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef PARSERCONTEXT_H
+#define PARSERCONTEXT_H
+
+#include <pthread.h>
+#include <map>
+#include <vector>
+#include "ECString.h"
+#include "Item.h"
+#include "ParseArena.h"
+#include "ProbCache.h"
+
+class LeftRightGotIter;
+
+/* Cell storage for a chart, sized to the sentence being parsed.  All the
+   per-span tables are kept in flat arrays indexed by span(st, ed), the
+   position of the span [st, ed) in the upper triangle of an
+   (len+1)x(len+1) matrix.  It is reused for every sentence parsed with
+   the same ParserContext, so short sentences only touch a few cells. */
+class ChartCells
+{
+ public:
+  ChartCells() : len_(-1) {}
+  void            reset(int len);
+  void            clear();
+  int             span(int st, int ed) const
+                    { return st*(len_+1) - (st*(st-1))/2 + ed - st; }
+  int             numSpans() const { return ((len_+1)*(len_+2))/2; }
+  vector<Items>   regs;         // items, by span
+  vector< vector<short> > guide;  // guide terms, by span
+  vector<Edges>   waitingEdges[2];  // by position
+  vector<int>     demerits;     // by span
+  vector<Edge*>   popped;
+ private:
+  int             len_;
+};
+
+/* A ParserContext holds all of the mutable state used while parsing a
+   sentence: the chart cells, the arena for Edges and Vals, the pool of
+   Items, the ids given to words not in the model, the rule the edge
+   features are currently looking at, and the probability cache.  The model itself is shared
+   and read-only, so charts built on different contexts can parse at
+   the same time.  A context may only be used by one chart at a time.
+
+   parseIt gives each of its threads its own context.  Library callers
+   such as the SimpleAPI borrow one for each parse with acquire() and
+   hand it back with release(). */
+class ParserContext
+{
+ public:
+  ParserContext();
+  ~ParserContext();
+  void            startSentence(int lastKnownWord);
+  Item*           newItem(const Term* trm);
+  void            releaseItems();
+  ChartCells      cells;
+  ParseArena      arena;
+  ProbCache       probs;     // meProb/meFHProb answers
+  LeftRightGotIter* gi;      // rule being scored, used by the edge features
+  int             lastWord;  // id given to the last unknown word
+  map<ECString, int> newWordMap;
+  vector<ECString> newWords;
+  bool            inUse;     // a chart is currently using this context
+  static ParserContext* acquire();
+  static void     release(ParserContext* ctx);
+ private:
+  vector<Item*>   items_;    // Items handed out by ChartBase::addtochart
+  int             numItems_; // how many of them this sentence has used
+  static vector<ParserContext*> pool_;
+  static pthread_mutex_t poolLock_;
+};
+
+#endif /* ! PARSERCONTEXT_H */
@@ -0,0 +1,73 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef PROBCACHE_H
+#define PROBCACHE_H
+
+#include <iostream>
+#include "Feature.h"
+
+#define MAXCACHEDFS 12
+
+/* Remembers the answers of MeChart::meProb and Bchart::meFHProb.  Given
+   the calc type, the conditioned value and the values of all of the
+   calc's subfeatures, the probability only depends on the (read-only)
+   model, so the same tuple always gets the same answer.  This lets us
+   skip the FeatureTree walk for histories the chart has already seen,
+   which in n-best parsing is most of them.
+
+   The cache is direct mapped with a fixed number of entries, each
+   holding the full key in one cache line, so a colliding tuple just
+   replaces the old entry.  Calcs with more than MAXCACHEDFS features
+   are not cached.  Each ParserContext has its own cache.  By default it is
+   emptied at the start of every sentence; with acrossSentences set it
+   is kept, which is still exact since nothing in the key depends on
+   the sentence.  Caching is off unless size is set (parseIt -q), since
+   on the models we measured the lookups cost more than they saved. */
+
+class ProbCache
+{
+ public:
+  ProbCache();
+  ~ProbCache();
+  bool       find(int whichInt, int cVal, const int* vals, int n, float& p);
+  void       store(int whichInt, int cVal, const int* vals, int n, float p);
+  void       newSentence();
+  void       addStats();
+  long       hits;
+  long       misses;
+  static int size;             // entries per cache, 0 turns caching off
+  static bool acrossSentences; // keep entries from earlier sentences
+  static void printStats(ostream& os);
+ private:
+  struct Entry
+  {
+    unsigned int gen;          // 0 for empty, else the generation stored
+    short      whichInt;
+    short      n;
+    int        cVal;
+    float      p;
+    int        vals[MAXCACHEDFS];
+  };
+  Entry*     slot(int whichInt, int cVal, const int* vals, int n);
+  ProbCache(const ProbCache&);
+  ProbCache& operator=(const ProbCache&);
+  Entry*     entries_;
+  unsigned int mask_;          // number of entries - 1
+  unsigned int gen_;
+  static long totalHits_;
+  static long totalMisses_;
+};
+
+#endif /* ! PROBCACHE_H */
@@ -0,0 +1,46 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef RERANKER_H
+#define RERANKER_H
+
+#include <iostream>
+#include "ECString.h"
+#include "ParseLoop.h"
+
+/* The second-stage reranker (../../second-stage/programs/features),
+   scoring the parser's n-best lists as they come out of parseLoop.
+   This header keeps the reranker's own headers out of the parser's
+   files, as some of their names clash.  A Reranker is not thread
+   safe: the reranker's symbol table is not. */
+class Reranker
+{
+ public:
+  /* reads the features file written by extract-spfeatures and the
+     weights file; featureClass is the -f of extract-spfeatures, or
+     empty for the default */
+  Reranker(const ECString& featureClass, const ECString& featuresFile,
+	   const ECString& weightsFile, bool absoluteCounts, bool lowercase);
+  ~Reranker();
+  /* writes the best of printS's parses to os, as best-parses would have
+     done given parseIt's output for it, or with ranked set all of
+     them, best first.  Deletes printS's trees. */
+  void rerank(printStruct& printS, bool ranked, ostream& os);
+ private:
+  struct Model;
+  Model* model_;
+  bool lowercase_;
+};
+
+#endif /* ! RERANKER_H */
@@ -88,6 +88,13 @@ class LabeledSpans: public vector<LabeledSpan> {
 vector<ScoredTree>* parse(SentRep* sent, ExtPos& tagConstraints,
                           LabeledSpans* spanConstraints);
 vector<ScoredTree>* parse(SentRep* sent);
+/* Parses each sentence in sents (with no constraints) on numThreads
+   threads, or one per CPU if numThreads < 1.  Element i of the result
+   holds the parses of sents[i] and belongs to the caller, as does each
+   tree in it.  A sentence that parse() would throw a ParserError on
+   gets an empty list. */
+vector<vector<ScoredTree>*>* parseBatch(const vector<SentRep*>& sents,
+                                        int numThreads);
 
 ParseStats* getParseStats(InputTree* proposed, InputTree* gold);
 
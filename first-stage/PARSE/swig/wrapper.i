@@ -51,6 +51,7 @@ typedef std::string ECString;
 }
 
 %newobject parse;
+%newobject parseBatch;
 %newobject tokenize;
 %newobject inputTreeFromString;
 %newobject inputTreesFromString;
@@ -61,6 +62,29 @@ typedef std::string ECString;
 %newobject asNBestList;
 %newobject treeLogProb;
 
+#ifdef SWIGPYTHON
+// parseBatch doesn't touch any Python objects, so let other Python
+// threads run while it parses.  A ParserError is only turned into a
+// Python exception once we hold the GIL again.
+%exception parseBatch {
+    {
+        bool failed = false;
+        std::string message;
+        Py_BEGIN_ALLOW_THREADS
+        try {
+            $action
+        } catch (ParserError pe) {
+            failed = true;
+            message = pe.description;
+        }
+        Py_END_ALLOW_THREADS
+        if (failed) {
+            SWIG_exception(SWIG_RuntimeError, message.c_str());
+        }
+    }
+}
+#endif
+
 %inline{
     const int max_sentence_length = MAXSENTLEN;
 
@@ -81,6 +105,7 @@ namespace std {
 
     %template(StringList) list<string>;
     %template(SentRepList) list<SentRep*>;
+    %template(SentRepVector) vector<SentRep*>;
     %template(InputTrees) list<InputTree*>;
 
     %template(StringVector) vector<string>;
@@ -114,10 +139,11 @@ class SentRep {
             // makeFailureTree() is adapted from makeFlat() in parseIt.C
             %newobject makeFailureTree;
             InputTree* makeFailureTree(string category) {
-                ChartBase::guided = false;
-                MeChart* chart = new MeChart(*$self, 0);
+                ParserContext* ctx = ParserContext::acquire();
+                MeChart* chart = new MeChart(*$self, *ctx);
                 if ($self->length() >= MAXSENTLEN) {
                     delete chart;
+                    ParserContext::release(ctx);
                     error("Sentence is too long.");
                 }
                 InputTrees dummy1;
@@ -139,6 +165,7 @@ class SentRep {
 
                 inner_tree->subTrees() = its;
                 delete chart;
+                ParserContext::release(ctx);
                 return top_tree;
             }
         }
@@ -315,4 +342,5 @@ class ParseStats {
 namespace std {
     %template(VectorLabeledSpan) vector<LabeledSpan>;
     %template(VectorScoredTree) vector<ScoredTree>;
+    %template(VectorVectorScoredTree) vector<vector<ScoredTree>*>;
 }
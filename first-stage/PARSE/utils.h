@@ -28,6 +28,9 @@ void warn(const char *filename, int filelinenum, const char *msg);
 void error(const char *filename, int filelinenum, const char *msg);
 void error(const char *filename, int filelinenum, string str);
 void error(const char *s); // backwards compatibility
+/* the sentence number warn() and error() report, if this thread sets
+   it; otherwise they report how many sentences have been read */
+extern __thread int warnSentence;
 
 ECString langAwareToLower(ECString str);
 ECString intToString(int i);
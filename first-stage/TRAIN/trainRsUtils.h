@@ -32,6 +32,9 @@
 #include "ClassRule.h"
 #include <cmath>
 
+/* number of sentences goThroughSents() walks on a thread at a time */
+#define TRBLOCKSIZE 16
+
 
 
 struct TrData 
@@ -40,6 +43,15 @@ struct TrData
   float pm;
 };
 
+/* TrIncr is an increment to trData[f][b] */
+struct TrIncr
+{
+  TrIncr(int f, int b, double c, double pm) : f(f), b(b), c(c), pm(pm) {}
+  int f, b;
+  double c;
+  double pm;
+};
+
 
 
 
@@ -76,5 +88,5 @@ pickLogBases(InputTree** trainingData, int sc);
 void
 lamInit();
 void
-goThroughSents(InputTree* trainingData[1301], int sc);
+goThroughSents(InputTree** trainingData, int sc);
 #endif
@@ -472,6 +472,10 @@ class NBestList(object):
             reranker_instance = reranker_instance.reranker_model
         reranker_input = self.as_reranker_input()
         scores = reranker_instance.scoreNBestList(reranker_input)
+        self._set_reranker_scores(scores)
+    def _set_reranker_scores(self, scores):
+        """Store the reranker's scores (in parser order) on our parses
+        and sort by them."""
         # this could be more efficient if needed
         for (score, nbest_list_item) in zip(scores, self.parses):
             nbest_list_item.reranker_score = score
@@ -530,7 +534,10 @@ class NBestList(object):
     def as_reranker_input(self, lowercase=True):
         """Convert the n-best list to an internal structure used as input
         to the reranker. You shouldn't typically need to call this."""
-        return reranker.readNBestList(str(self), lowercase)
+        # built straight from the parser's trees, which gives the same
+        # result as reranker.readNBestList(str(self)) without printing
+        # and rereading them
+        return reranker.nbestListFromTrees(self._parses, lowercase)
 
 class RerankingParser:
     """Wraps the Charniak parser and Johnson reranker into a single
@@ -630,6 +637,53 @@ class RerankingParser:
             nbest_list.rerank(self)
         return nbest_list
 
+    def parse_batch(self, sentences, rerank='auto', sentence_ids=None,
+                    num_threads=None):
+        """Parse a sequence of sentences and return a list with an
+        NBestList for each, in the same order. Each sentence can be a
+        string or a sequence, as in parse(). The sentences are parsed
+        (and reranked) on num_threads threads (default: one per CPU)
+        and other Python threads can run in the meantime. sentence_ids,
+        if given, has an id for each sentence. The rerank flag is the
+        same as in parse()."""
+        rerank = self.check_models_loaded_or_error(rerank)
+
+        sentences = [Sentence(sentence) for sentence in sentences]
+        for sentence in sentences:
+            if len(sentence) >= parser.max_sentence_length - 1:
+                raise ValueError("Sentence is too long (%s tokens, must be "
+                                 "under %s)" %
+                                 (len(sentence),
+                                  parser.max_sentence_length - 1))
+        if sentence_ids is None:
+            sentence_ids = [None] * len(sentences)
+        num_threads = num_threads or 0
+
+        sentreps = parser.SentRepVector([sentence.sentrep
+                                         for sentence in sentences])
+        nbest_lists = []
+        for sentence, parses, sentence_id in \
+                zip(sentences, parser.parseBatch(sentreps, num_threads),
+                    sentence_ids):
+            # acquire each list or it'll never be freed
+            parses.this.acquire()
+            nbest_lists.append(NBestList(sentence, parses, sentence_id))
+
+        if rerank:
+            to_rerank = [nbest_list for nbest_list in nbest_lists
+                         if nbest_list.parses]
+            for nbest_list in nbest_lists:
+                if not nbest_list.parses:
+                    nbest_list._reranked = True
+            # keep the reranker inputs alive until they're scored
+            reranker_inputs = [nbest_list.as_reranker_input()
+                               for nbest_list in to_rerank]
+            all_scores = self.reranker_model.scoreNBestLists(
+                reranker.NBestListVector(reranker_inputs), num_threads)
+            for nbest_list, scores in zip(to_rerank, all_scores):
+                nbest_list._set_reranker_scores(scores)
+        return nbest_lists
+
     def parse_tagged(self, tokens, possible_tags, rerank='auto',
                      sentence_id=None):
         """Parse some pre-tagged, pre-tokenized text. tokens must be a
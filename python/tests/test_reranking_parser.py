@@ -14,6 +14,7 @@ from __future__ import print_function
 
 import unittest
 from bllipparser import Sentence, tokenize, RerankingParser, Tree
+from bllipparser import JohnsonReranker
 from bllipparser.RerankingParser import (NBestList, ScoredParse,
                                          get_unified_model_parameters)
 
@@ -829,6 +830,33 @@ class RerankingParserTests(unittest.TestCase):
         self.assertEqual(str(nbest_list_fail), '0 x')
         nbest_list_fail = rrp.parse_constrained('# ! ? : -'.split(), {})
         self.assertEqual(len(nbest_list_fail), 0)
+
+        # batch parsing gives the same n-best lists as parse()
+        batch_sentences = ['This is a sentence.', '# ! ? : -',
+                           ['This', 'is', 'a', 'pretokenized', 'sentence',
+                            '.'], 'The list is smaller now.']
+        nbest_lists = rrp.parse_batch(batch_sentences, num_threads=2)
+        self.assertEqual(len(nbest_lists), 4)
+        for sentence, nbest_list in zip(batch_sentences, nbest_lists):
+            self.assertEqual(str(nbest_list), str(rrp.parse(sentence)))
+        nbest_lists = rrp.parse_batch(batch_sentences, rerank=False,
+                                      sentence_ids=['a', 'b', 'c', 'd'])
+        self.assertEqual(str(nbest_lists[1]), '0 b')
+        self.assertEqual(str(nbest_lists[3]),
+                         str(rrp.parse('The list is smaller now.',
+                                       rerank=False, sentence_id='d')))
+        self.assertEqual(rrp.parse_batch([]), [])
+        self.assertRaises(ValueError, rrp.parse_batch, ['ok', 'a ' * 399])
+
+        # the reranker input built from the parser's trees scores the
+        # same as the one read from their text
+        nbest_list = rrp.parse('This is a sentence.', rerank=False)
+        reranker_input = nbest_list.as_reranker_input()
+        self.assertEqual(len(reranker_input), len(nbest_list))
+        text_input = JohnsonReranker.readNBestList(str(nbest_list), True)
+        self.assertEqual(list(rrp.reranker_model.scoreNBestList(
+                         reranker_input)),
+                         list(rrp.reranker_model.scoreNBestList(text_input)))
     def test_3_tree_funcs(self):
         # these are here and not in test_tree since they require a parsing
         # model to have been loaded
@@ -24,27 +24,128 @@
 #include "custom_allocator.h"       // must be first
 
 #include "sym.h"
+#include <atomic>
 #include <cctype>
+#include <mutex>
 
 #define ESCAPE     '\\'
 #define OPENQUOTE  '\"'
 #define CLOSEQUOTE '\"'
 #define UNDEFINED  "%UNDEFINED%"           // UNDEFINED must start with punctuation
 
+// The symbol table is split into shards, each of which is an open-addressed
+// hash table of pointers to the interned strings.  A slot is written only
+// once, from NULL to its final value, and when a shard grows its old slot
+// array is never freed, so finding a string that is already interned takes
+// no locks.  Interning a new string locks its shard.
+//
+class symbol::Table {
+
+  struct Entry {
+    size_t hash;
+    std::string str;
+    Entry(size_t hash, const std::string& str) : hash(hash), str(str) { }
+  };
+
+  struct Slots {
+    size_t mask;                            // number of slots - 1
+    std::atomic<const Entry*>* slots;
+    Slots(size_t nslots) : mask(nslots - 1), slots(new std::atomic<const Entry*>[nslots]) {
+      for (size_t i = 0; i < nslots; ++i)
+	slots[i].store(NULL, std::memory_order_relaxed);
+    }
+  };
+
+  struct Shard {
+    std::atomic<Slots*> slots;
+    std::atomic<size_t> nentries;
+    std::mutex mutex;
+    Shard() : slots(new Slots(1024)), nentries(0) { }
+  };
+
+  enum { shardbits = 6, nshards = 1 << shardbits };
+  Shard shards[nshards];
+
+  static size_t hash(const std::string& s) {  // FNV-1a
+    size_t h = size_t(14695981039346656037ULL);
+    for (std::string::const_iterator p = s.begin(); p != s.end(); ++p)
+      h = (h ^ (unsigned char) *p) * size_t(1099511628211ULL);
+    return h;
+  }
+
+  // find() returns the entry for s in slots, or NULL if there is none
+  //
+  static const Entry* find(const Slots* slots, size_t h, const std::string& s) {
+    for (size_t i = (h >> shardbits) & slots->mask; ; i = (i + 1) & slots->mask) {
+      const Entry* e = slots->slots[i].load(std::memory_order_acquire);
+      if (e == NULL)
+	return NULL;
+      if (e->hash == h && e->str == s)
+	return e;
+    }
+  }
+
+  // place() puts e in the first free slot for it; the shard must be locked
+  //
+  static void place(Slots* slots, const Entry* e) {
+    size_t i = (e->hash >> shardbits) & slots->mask;
+    while (slots->slots[i].load(std::memory_order_relaxed) != NULL)
+      i = (i + 1) & slots->mask;
+    slots->slots[i].store(e, std::memory_order_release);
+  }
+
+public:
+
+  const std::string* intern(const std::string& s) {
+    size_t h = hash(s);
+    Shard& shard = shards[h & (nshards - 1)];
+    const Entry* e = find(shard.slots.load(std::memory_order_acquire), h, s);
+    if (e != NULL)
+      return &e->str;
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    Slots* slots = shard.slots.load(std::memory_order_relaxed);
+    e = find(slots, h, s);
+    if (e != NULL)
+      return &e->str;
+    size_t nentries = shard.nentries.load(std::memory_order_relaxed) + 1;
+    if (2 * nentries > slots->mask) {       // keep the shard at most half full
+      Slots* newslots = new Slots(2 * (slots->mask + 1));
+      for (size_t i = 0; i <= slots->mask; ++i) 
+	if (const Entry* e1 = slots->slots[i].load(std::memory_order_relaxed))
+	  place(newslots, e1);
+      shard.slots.store(newslots, std::memory_order_release);
+      slots = newslots;                     // the old slots may still be being read
+    }
+    e = new Entry(h, s);
+    place(slots, e);
+    shard.nentries.store(nentries, std::memory_order_relaxed);
+    return &e->str;
+  }
+
+  size_t size() const {
+    size_t n = 0;
+    for (size_t i = 0; i < nshards; ++i)
+      n += shards[i].nentries.load(std::memory_order_relaxed);
+    return n;
+  }
+};  // symbol::Table{}
+
 // define these as local static variables to avoid static initialization order bugs
 //
 symbol::Table& symbol::table() 
 {
-  static Table table_(65536);   // default table size
+  static Table table_;
   return table_;
 }
 
-symbol::symbol(const std::string& s) : sp(&*(table().insert(s).first)) { };
+size_t symbol::size() { return table().size(); }
+
+symbol::symbol(const std::string& s) : sp(table().intern(s)) { };
 
 symbol::symbol(const char* cp) { 
   if (cp) {
     std::string s(cp); 
-    sp = &*(table().insert(s).first);
+    sp = table().intern(s);
   }
   else
     sp = NULL;
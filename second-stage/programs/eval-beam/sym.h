@@ -28,6 +28,10 @@
 // symbols can be compared and hashed just like other symbols, but it is an
 // error to obtain the string pointed to by an undefined symbol.
 //
+// Symbols may be constructed concurrently from any number of threads.
+// Looking up a symbol that already exists takes no locks, and the
+// string a symbol points to never moves.
+//
 // Symbols possess write/read invariance, i.e., you can write a symbol
 // to a stream and read it from the same stream.  (Note that the relative
 // ordering of symbols is not preserved, since the underlying string objects
@@ -98,32 +102,11 @@ namespace ext = EXT_NAMESPACE;
 
 class symbol {
 
-  struct hashstr //  This is the fn hashpjw of Aho, Sethi and Ullman, p 436.
-  {
-    size_t operator()(const std::string& s) const 
-    {
-      typedef std::string::const_iterator CI;
-      
-      unsigned long h = 0; 
-      unsigned long g;
-      CI p = s.begin();
-      CI end = s.end();
-      
-      while (p!=end) {
-	h = (h << 4) + (*p++);
-	if ((g = h&0xf0000000)) {
-	  h = h ^ (g >> 24);
-	  h = h ^ g;
-	}}
-      return size_t(h);
-    }
-  };
-
   typedef std::string* stringptr;
   const std::string* sp;
   symbol(const std::string* sp_) : sp(sp_) { }
 
-  typedef ext::hash_set<std::string, hashstr> Table;
+  class Table;                  // the symbol table, defined in sym.cc
   static Table& table();
 
 public:
@@ -141,7 +124,7 @@ public:
   const char* c_str() const { assert(is_defined()); return sp->c_str(); }
 
   static symbol undefined() { return symbol(stringptr(NULL)); }
-  static size_t size() { return table().size(); }
+  static size_t size();
 
   bool operator== (const symbol s) const { return sp == s.sp; }
   bool operator!= (const symbol s) const { return sp != s.sp; }
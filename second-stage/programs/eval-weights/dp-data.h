@@ -26,6 +26,7 @@
 #include <vector>
 
 #include "tree.h"
+#include "zfile.h"
 
 typedef unsigned int size_type;
 #define SCANF_SIZE_TYPE_FORMAT "%u"
@@ -276,20 +277,16 @@ struct corpus_type {
     FILE* fp = popen_decompress(filename);
     bool successful_read = read(fp, downcase_flag, ignore_trees);
     assert(successful_read);
-    pclose(fp);
+    fclose(fp);
   }  // corpus_type::corpus_type()
 
-  // popen_decompress() returns a popen FILE* to filename.
+  // popen_decompress() returns a FILE* to filename, which is decompressed
+  // in-process if its suffix is .bz2 or .gz (see zfile.h).
   //
   inline static FILE* popen_decompress(const char filename[]) {
-    const char* filesuffix = strrchr(filename, '.');
-    std::string command(strcasecmp(filesuffix, ".bz2")
-			? (strcasecmp(filesuffix, ".gz") ? "cat " : "gunzip -c ")
-			: "bzcat ");
-    command += filename;
-    FILE* fp = popen(command.c_str(), "r");
+    FILE* fp = zfopen(filename, "r");
     if (fp == NULL) {
-      std::cerr << "## Error: could not popen command " << filename << std::endl;
+      std::cerr << "## Error: could not open " << filename << std::endl;
       exit(EXIT_FAILURE);
     }
     return fp;
@@ -342,7 +339,7 @@ struct corpus_type {
 			      bool downcase_flag = false, bool ignore_trees=false) {
     FILE* fp = popen_decompress(filename);
     size_type nsentences = map_sentences(fp, proc, downcase_flag, ignore_trees);
-    pclose(fp);
+    fclose(fp);
     return nsentences;
   }  // corpus_type::map_sentences()
 };  // corpus_type{}
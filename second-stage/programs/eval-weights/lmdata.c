@@ -19,6 +19,7 @@
  * This is a version of data.c with additions for pairwise loss functions.
  */
 
+#include "zfile.h"    /* must be first, it defines _GNU_SOURCE */
 #include "lmdata.h"
 
 #include <assert.h>
@@ -418,40 +419,14 @@ corpus_type *read_corpus(corpusflags_type *flags, FILE *in) {
 }  /* read_corpus() */
 
 corpus_type *read_corpus_file(corpusflags_type *flags, const char* filename) {
-  const char* filesuffix = strrchr(filename, '.');
-  char *command = NULL;
-  FILE *in;
+  FILE *in = zfopen(filename, "r");
   corpus_type *corpus;
-  if (strcasecmp(filesuffix, ".bz2") == 0) {
-    const char bzcat[] = "bzcat ";
-    command = malloc(sizeof(bzcat)+strlen(filename)+1);
-    strcpy(command, bzcat);
-    strcat(command, filename);
-    in = popen(command, "r");
-  }
-  else if (strcasecmp(filesuffix, ".gz") == 0) {
-    const char zcat[] = "gunzip -c ";
-    command = malloc(sizeof(zcat)+strlen(filename)+1);
-    strcpy(command, zcat);
-    strcat(command, filename);
-    in = popen(command, "r");
-  }
-  else
-    in = fopen(filename, "r");
   if (in == NULL) {
-    if (command == NULL) 
-      fprintf(stderr, "## Error: couldn't open corpus file %s\n", filename);
-    else
-      fprintf(stderr, "## Error: couldn't popen command %s\n", command);
+    fprintf(stderr, "## Error: couldn't open corpus file %s\n", filename);
     exit(EXIT_FAILURE);
   }
   corpus = read_corpus(flags, in);
-  if (command != NULL) {
-    free(command);
-    pclose(in);
-  }
-  else
-    fclose(in);
+  fclose(in);
   return corpus;
 }  /* read_corpus_file() */
 
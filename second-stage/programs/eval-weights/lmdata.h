@@ -92,8 +92,8 @@ size_type max_score_index(const sentence_type *s, const Float w[]);
 corpus_type *read_corpus(corpusflags_type *flags, FILE *in);
 
 /*! read_corpus_file() reads corpus from the file named filename.  
- *! If the filename suffix ends in .bz2 it is popened with bzcat,
- *! if it ends in .gz it is popened with zcat.
+ *! If the filename suffix ends in .bz2 or .gz it is decompressed
+ *! in-process with libbz2 or zlib (see zfile.h).
  */
 
 corpus_type *read_corpus_file(corpusflags_type *flags, const char* filename);
@@ -19,7 +19,7 @@ const char usage[] =
   "\n"
   "Usage:\n"
   "\n"
-  "best-parses [-a] [-l] [-m mode] feat-defs.bz2 feat-weights.bz2 < nbest-parses > best-parses\n"
+  "best-parses [-a] [-l] [-m mode] [-t threads] feat-defs.bz2 feat-weights.bz2 < nbest-parses > best-parses\n"
   "\n"
   "where:\n"
   "\n"
@@ -33,6 +33,7 @@ const char usage[] =
   "    2 print feature counts,\n"
   "    3 print 1-best tree with syntactic heads,\n"
   "    4 print 1-best tree with semantic heads,\n"
+  " -t <threads> reranks sentences on <threads> threads while another reads them,\n"
   "\n"
   " feat-defs.bz2 is a feature definition file produced by extract-spfeatures, and\n"
   " feat-weights.bz2 is a feature weight file\n"
@@ -44,8 +45,13 @@ const char usage[] =
 // #include <boost/lexical_cast.hpp>
 #include <cassert>
 #include <cstdlib>
+#include <sstream>
+#include <string>
 #include <vector>
 #include <getopt.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #include "popen.h"
 #include "sp-data.h"
@@ -56,16 +62,55 @@ bool absolute_counts = true;
 bool collect_correct = false;
 bool collect_incorrect = false;
 
+//! write_parses() writes the output for sentence s required by mode to os.
+//
+static void write_parses(std::ostream& os, const FeatureClassPtrs& fcps,
+			 const sp_sentence_type& s, const std::vector<Float>& weights,
+			 int mode) {
+  switch (mode) {
+  case 0:
+    write_tree_noquote_root(os, fcps.best_parse(s, weights));
+    os << std::endl;
+    break;
+  case 1:
+    fcps.write_ranked_trees(s, weights, os);
+    break;
+  case 2:
+    fcps.write_features_debug(s, weights, os);
+    break;
+  case 3:
+    write_tree_noquote_root_with_heads(os, fcps.best_parse(s, weights), true);
+    os << std::endl;
+    break;
+  case 4:
+    write_tree_noquote_root_with_heads(os, fcps.best_parse(s, weights), false);
+    os << std::endl;
+    break;
+  }
+}  // write_parses()
+
+//! read_sentences() reads up to ss.size() sentences from is into ss,
+//! and returns the number read.
+//
+static size_type read_sentences(std::istream& is, sp_sentences_type& ss, 
+				bool lowercase_flag) {
+  size_type n = 0;
+  while (n < ss.size() && ss[n].read(is, lowercase_flag))
+    ++n;
+  return n;
+}  // read_sentences()
+
 int main(int argc, char **argv) {
 
   bool lowercase_flag = false;
   int mode = 0;
+  int nthreads = 1;
 
   std::ios::sync_with_stdio(false);
   const char* fcname = NULL;
 
   int c;
-  while ((c = getopt(argc, argv, "ad:f:lm:")) != -1 )
+  while ((c = getopt(argc, argv, "ad:f:lm:t:")) != -1 )
     switch (c) {
     case 'a':
       absolute_counts = false;
@@ -82,6 +127,9 @@ int main(int argc, char **argv) {
     case 'm':
       mode = atoi(optarg);
       break;
+    case 't':
+      nthreads = atoi(optarg);
+      break;
     default:
       std::cerr << "## Error: can't interpret argument " << c << " " << optarg << std::endl;
       std::cerr << usage << std::endl;
@@ -93,9 +141,15 @@ int main(int argc, char **argv) {
     exit(EXIT_FAILURE);
   }
 
+  if (mode < 0 || mode > 4) {
+    std::cerr << "## Error: unknown mode = " << mode << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
   if (debug_level > 0)
     std::cerr 
       << "# lowercase_flag (-l) = " << lowercase_flag
+      << ", nthreads (-t) = " << nthreads
       << std::endl;
 
   // initialize feature classes
@@ -127,32 +181,52 @@ int main(int argc, char **argv) {
     weights[id] = weight;
   }
   
-  sp_sentence_type s;
-  while (s.read(std::cin, lowercase_flag)) {
-    switch (mode) {
-    case 0:
-      write_tree_noquote_root(std::cout, fcps.best_parse(s, weights));
-      std::cout << std::endl;
-      break;
-    case 1:
-      fcps.write_ranked_trees(s, weights, std::cout);
-      break;
-    case 2:
-      fcps.write_features_debug(s, weights, std::cout);
-      break;
-    case 3:
-      write_tree_noquote_root_with_heads(std::cout, fcps.best_parse(s, weights), true);
-      std::cout << std::endl;
-      break;
-    case 4:
-      write_tree_noquote_root_with_heads(std::cout, fcps.best_parse(s, weights), false);
-      std::cout << std::endl;
-      break;
-    default:
-      std::cerr << "## Error: unknown mode = " << mode << std::endl;
-      exit(EXIT_FAILURE);
-      break;
+  if (nthreads <= 1) {
+    sp_sentence_type s;
+    while (s.read(std::cin, lowercase_flag)) 
+      write_parses(std::cout, fcps, s, weights, mode);
+    return EXIT_SUCCESS;
+  }
+
+  // The sentences are processed in batches.  While nthreads threads
+  // rerank the sentences in one batch, another thread reads the next
+  // batch and then joins them.  Each batch's output is collected and
+  // written in input order.  The feature ids and weights are only read.
+
+  const size_type batchsize = 16 * nthreads;
+  sp_sentences_type sentences(batchsize), next_sentences(batchsize);
+  std::vector<std::string> outputs(batchsize);
+  size_type nsentences = read_sentences(std::cin, sentences, lowercase_flag);
+
+  while (nsentences > 0) {
+    size_type next_nsentences = 0;
+    size_type nextsentence = 0;
+
+#pragma omp parallel num_threads(nthreads + 1)
+    {
+#ifdef _OPENMP
+      if (omp_get_thread_num() == 0)
+#endif
+	next_nsentences = read_sentences(std::cin, next_sentences, lowercase_flag);
+      
+      while (true) {
+	size_type i;
+#pragma omp atomic capture
+	i = nextsentence++;
+	if (i >= nsentences)
+	  break;
+	std::ostringstream os;
+	write_parses(os, fcps, sentences[i], weights, mode);
+	outputs[i] = os.str();
+      }
     }
+
+    for (size_type i = 0; i < nsentences; ++i) 
+      std::cout << outputs[i];
+    std::cout << std::flush;
+
+    sentences.swap(next_sentences);
+    nsentences = next_nsentences;
   }
 
 } // main()
@@ -27,6 +27,7 @@
 #include <vector>
 
 #include "tree.h"
+#include "zfile.h"
 
 typedef unsigned int size_type;
 
@@ -299,18 +300,19 @@ struct corpus_type {
     FILE* goldfp = popen_decompress(goldfilename);
     bool successful_read = read(parsefp, goldfp, downcase_flag, ignore_trees);
     assert(successful_read);
-    pclose(parsefp);
-    pclose(goldfp);
+    fclose(parsefp);
+    fclose(goldfp);
   }  // corpus_type::corpus_type()
 
-  // popen_decompress() returns a popen FILE* to filename.
+  // popen_decompress() returns a FILE* to the bzip2'd file filename,
+  // which is decompressed in-process (see zfile.h).
   //
   inline static FILE* popen_decompress(const char filename[]) {
     std::string command("bzcat ");
     command += filename;
-    FILE* fp = popen(command.c_str(), "r");
+    FILE* fp = zpopen(command.c_str());
     if (fp == NULL) {
-      std::cerr << "## Error: could not popen command " << filename << std::endl;
+      std::cerr << "## Error: could not open " << filename << std::endl;
       exit(EXIT_FAILURE);
     }
     return fp;
@@ -364,8 +366,8 @@ struct corpus_type {
     FILE* parsefp = popen_decompress(parsefilename);
     FILE* goldfp = popen_decompress(goldfilename);
     size_type nsentences = map_sentences(parsefp, goldfp, proc, downcase_flag, ignore_trees);
-    pclose(parsefp);
-    pclose(goldfp);
+    fclose(parsefp);
+    fclose(goldfp);
     return nsentences;
   }  // corpus_type::map_sentences()
 
@@ -374,11 +376,11 @@ struct corpus_type {
   template <typename Proc>
   static size_type map_sentences_cmd(const char parsecmd[], const char goldcmd[], Proc& proc, 
 			      bool downcase_flag = false, bool ignore_trees=false) {
-    FILE* parsefp = popen(parsecmd, "r");
-    FILE* goldfp = popen(goldcmd, "r");
+    FILE* parsefp = zpopen(parsecmd);
+    FILE* goldfp = zpopen(goldcmd);
     size_type nsentences = map_sentences(parsefp, goldfp, proc, downcase_flag, ignore_trees);
-    pclose(parsefp);
-    pclose(goldfp);
+    fclose(parsefp);
+    fclose(goldfp);
     return nsentences;
   }  // corpus_type::map_sentences()
 
@@ -17,7 +17,7 @@
 const char usage[] =
 "Usage:\n"
 "\n"
-"extract-spfeatures [-a] [-c] [-d <debug>] [-f <f>] [-i] [-l] [-s <s>] \n"
+"extract-spfeatures [-a] [-c] [-d <debug>] [-f <f>] [-i] [-j <jobs>] [-l] [-s <s>] \n"
 "  train.nbest.cmd train.gold.cmd train.gz\n"
 " (dev.nbest.cmd dev.gold.cmd dev.gz)*\n"
 "\n"
@@ -27,6 +27,7 @@ const char usage[] =
 " -d <debug> turns on debugging output,\n"
 " -f <f> uses feature classes <f>,\n"
 " -i collect features from incorrect examples,\n"
+" -j <jobs> counts the training features in <jobs> parallel processes,\n"
 " -l maps all words to lower case as trees are read,\n"
 " -s <s> is the number of sentences a feature must appear in not to be pruned,\n"
 "\n"
@@ -67,9 +68,10 @@ int main(int argc, char **argv) {
                           //  in to be counted
 
   const char* fcname = NULL;
+  unsigned njobs = 1;     // (-j)  number of processes counting features
 
   int c;
-  while ((c = getopt(argc, argv, "acd:f:ils:")) != -1 )
+  while ((c = getopt(argc, argv, "acd:f:ij:ls:")) != -1 )
     switch (c) {
     case 'a':
       absolute_counts = true;
@@ -86,6 +88,9 @@ int main(int argc, char **argv) {
     case 'i':
       collect_incorrect = true;
       break;
+    case 'j':
+      njobs = atoi(optarg);
+      break;
     case 'l':
       lowercase_flag = true;
       break;
@@ -109,6 +114,7 @@ int main(int argc, char **argv) {
     << ", absolute_counts (-a) = " << absolute_counts
     << ", collect_correct (-c) = " << collect_correct
     << ", collect_incorrect (-i) = " << collect_incorrect
+    << ", njobs (-j) = " << njobs
     << ", mincount (-s) = " << mincount 
     << ", lowercase_flag (-l) = " << lowercase_flag
     << std::endl;
@@ -125,7 +131,7 @@ int main(int argc, char **argv) {
   // extract features from training data
   
   if (collect_correct || collect_incorrect)
-    fcps.extract_features(argv[optind], argv[optind+1]);   
+    fcps.extract_features(argv[optind], argv[optind+1], njobs);
 
   Id maxid = fcps.prune_and_renumber(mincount);
   std::cerr << "# maxid = " << maxid << ", usage " << resource_usage() << std::endl;
@@ -56,6 +56,7 @@
 #include "sp-multidata.h"
 #include "heads.h"
 #include "popen.h"
+#include "sparse-vector.h"
 #include "sptree.h"
 #include "sym.h"
 #include "tree.h"
@@ -105,7 +106,7 @@ typedef unsigned int size_type;
 typedef size_type Id;           //!< type of feature Ids
 #define SCANF_ID_TYPE "%u"
 
-typedef std::map<Id,Float> Id_Float;
+typedef sparse_vector<Id,Float> Id_Float;
 typedef std::vector<Id_Float> Id_Floats;
 
 ////////////////////////////////////////////////////////////////////////
@@ -273,19 +274,25 @@ public:
   };  // FeatureClass::FeatureParseVal{}
 
   //! An IdParseVal object is like a FeatureParseVal object except that
-  //! it maps each feature to its Id first
+  //! it maps each feature to its Id first.  The current parse's values
+  //! are collected in a sparse_vector, and end_parse() appends them to
+  //! f_p_vs, so a sentence's values are gathered without allocating a
+  //! map node per feature and parse.
   //
   template <typename FeatClass>
   struct IdParseVal {
     typedef typename FeatClass::Feature Feature;
     typedef Id F;
     typedef Float V;
-    typedef std::map<size_type,V> C_V;
-    typedef std::map<F,C_V> F_C_V;
+    typedef sparse_vector<F,V> F_V;
+    typedef std::pair<size_type,V> P_V;
+    typedef std::pair<F,P_V> F_P_V;
+    typedef std::vector<F_P_V> F_P_Vs;
 
     FeatClass& fc;
     size_type  parse;
-    F_C_V      f_p_v;
+    F_V        f_v;     // feature -> value for the current parse
+    F_P_Vs     f_p_vs;  // (feature, (parse, value)) for the parses so far
     V	       ignored;
 
     IdParseVal(FeatClass& fc) : fc(fc), ignored(0) { }
@@ -294,11 +301,24 @@ public:
       typedef typename FeatClass::Feature_Id::const_iterator It;
       It it = fc.feature_id.find(f);
       if (it != fc.feature_id.end())
-	return f_p_v[it->second][parse];
+	return f_v[it->second];
       else 
 	return ignored;
     }  // IdParseVal::operator[]
 
+    void clear() {
+      f_v.clear();
+      f_p_vs.clear();
+    }  // IdParseVal::clear()
+
+    //! end_parse() moves the current parse's values into f_p_vs
+    //
+    void end_parse() {
+      cforeach (typename F_V, it, f_v)
+	f_p_vs.push_back(F_P_V(it->first, P_V(parse, it->second)));
+      f_v.clear();
+    }  // IdParseVal::end_parse()
+
   };  // FeatureClass::IdParseVal{}
       
   //! sentence_parsefidvals() calls parse_featurecount() to get the
@@ -313,45 +333,64 @@ public:
 
     assert(parse_fid_val.size() == s.nparses());
 
-    fid_parse_val.f_p_v.clear();
+    fid_parse_val.clear();
 
     for (size_type i = 0; i < s.nparses(); ++i) {
       fid_parse_val.parse = i;
       fc.parse_featurecount(fc, s.parses[i], fid_parse_val);
+      fid_parse_val.end_parse();
     }
 
-    // copy into parse_fid_val, removing pseudo-constant features
+    // group the values by feature; within a feature they stay in
+    // parse order because the sort is stable
 
     typedef typename Fid_Parse_Val::F F;
     typedef typename Fid_Parse_Val::V V;
-    typedef typename Fid_Parse_Val::C_V C_V;
-    typedef typename Fid_Parse_Val::F_C_V F_C_V;
+    typedef typename Fid_Parse_Val::F_P_Vs F_P_Vs;
+    typedef typename F_P_Vs::const_iterator It;
     typedef std::map<V, size_type> V_C;
 
-    cforeach (typename F_C_V, fit, fid_parse_val.f_p_v) {
+    F_P_Vs& f_p_vs = fid_parse_val.f_p_vs;
+    std::stable_sort(f_p_vs.begin(), f_p_vs.end(), first_lessthan());
+
+    // copy into parse_fid_val, removing pseudo-constant features
+
+    for (It fit = f_p_vs.begin(); fit != f_p_vs.end(); ) {
       const F& feat = fit->first;
-      const C_V& parse_val = fit->second;
+      It fend = fit;
+      while (fend != f_p_vs.end() && fend->first == feat)
+	++fend;
       if (absolute_counts) {
-	for (size_type i = 0; i < s.nparses(); ++i) {
-	  V val = dfind(parse_val, i);
+	for (It it = fit; it != fend; ++it) {
+	  V val = it->second.second;
 	  if (val != 0)
-	    parse_fid_val[i][feat] = val;
+	    parse_fid_val[it->second.first][feat] = val;
 	}
       }
       else {  // relative counts
 	V_C val_gain;  // number of times each feature value occured
-	for (size_type i = 0; i < s.nparses(); ++i) {
-	  const V val = dfind(parse_val, i);
+	for (It it = fit; it != fend; ++it) {
+	  const V val = it->second.second;
 	  val_gain[val] += 2;
 	  val_gain[val-1] += 1;
 	}
+	size_type nzero = s.nparses() - (fend - fit);  // parses without feat
+	if (nzero > 0) {
+	  val_gain[0] += 2*nzero;
+	  val_gain[-1] += nzero;
+	}
 	const V& highest_gain_val = max_element(val_gain, second_lessthan())->first;
+	It it = fit;
 	for (size_type i = 0; i < s.nparses(); ++i) {
-	  const V val = dfind(parse_val, i) - highest_gain_val;
+	  V val = 0;
+	  if (it != fend && it->second.first == i)
+	    val = (it++)->second.second;
+	  val -= highest_gain_val;
 	  if (val != 0)
 	    parse_fid_val[i][feat] = val;
 	}
       }
+      fit = fend;
     }
   }  // FeatureClass::sentence_parsefidvals()
 
@@ -0,0 +1,67 @@
+// Licensed under the Apache License, Version 2.0 (the "License"); you may
+// not use this file except in compliance with the License.  You may obtain
+// a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations
+// under the License.
+
+// parser-nbest.h -- Copy first-stage parser output into sp_sentence_type
+//
+// A program that links the first-stage parser and the reranker into
+// one process can use these instead of printing the n-best parses and
+// reading them back in with sp_sentence_type::read().  The results are
+// the same as the text round trip.
+//
+// Include this after sp-data.h and the first-stage InputTree.h.
+
+#ifndef PARSER_NBEST_H
+#define PARSER_NBEST_H
+
+#include <cstdio>
+#include <cstdlib>
+
+//! inputtree_tree() copies a first-stage parse into a tree.  Each node
+//! gets the label operator>>() would give it if the parse had been
+//! printed with InputTree::printproper() and read back in.
+//
+inline tree* inputtree_tree(InputTree* it) {
+  if (!it->word().empty())      // preterminal
+    return new tree(symbol(it->term()), new tree(symbol(it->word())));
+  tree* tp = new tree(symbol(it->term() + it->ntInfo()));
+  tree** last = &tp->child;
+  for (InputTreesIter sit = it->subTrees().begin();
+       sit != it->subTrees().end(); ++sit) {
+    *last = inputtree_tree(*sit);
+    last = &(*last)->next;
+  }
+  return tp;
+}  // inputtree_tree()
+
+//! printed_logprob() rounds a log probability to the precision parseIt
+//! prints it with (or to digits significant digits), so that the
+//! reranker's log probability features see the values they were
+//! trained on.
+//
+inline Float printed_logprob(double logprob, int digits=6) {
+  char buf[32];
+  snprintf(buf, sizeof buf, "%.*g", digits, logprob);
+  return strtod(buf, NULL);
+}  // printed_logprob()
+
+//! inputtree_parse() sets p to a copy of the first-stage parse it, whose
+//! log probability (log2 p(parse) - len * log2 600, as the first stage
+//! reports it) is logprob.  Once all of a sentence's parses are set the
+//! caller should call sp_sentence_type::set_logcondprob().  logprob
+//! is rounded to digits significant digits.
+//
+inline void inputtree_parse(sp_parse_type& p, double logprob, InputTree* it,
+			    bool downcase_flag=false, int digits=6) {
+  p.set(printed_logprob(logprob, digits), inputtree_tree(it), downcase_flag);
+}  // inputtree_parse()
+
+#endif // PARSER_NBEST_H
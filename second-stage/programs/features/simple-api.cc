@@ -19,6 +19,9 @@
 
 #include <sstream>
 #include <iostream>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #include "popen.h"
 #include "sp-data.h"
@@ -26,6 +29,10 @@
 
 #include "simple-api.h"
 
+// the first-stage parser's trees, from ../../../first-stage/PARSE
+#include "InputTree.h"
+#include "parser-nbest.h"
+
 // externed variables
 int debug_level = 0;
 bool absolute_counts = true;
@@ -69,23 +76,22 @@ RerankerModel::RerankerModel(const char* feature_class,
 
 Weights*
 RerankerModel::scoreNBestList(const sp_sentence_type& nbest_list) const {
-    Id_Floats p_i_v(nbest_list.nparses());
-    cforeach (FeatureClassPtrs, it, *fcps)
-        (*it)->feature_values(nbest_list, p_i_v);
-
     Weights* parse_scores = new Weights();
+    fcps->parse_scores(nbest_list, *weights, *parse_scores);
+    return parse_scores;
+}
 
-    for (size_type i = 0; i < nbest_list.nparses(); ++i) {
-        const Id_Float& i_v = p_i_v[i];
-
-        Float w = 0;
-        cforeach (Id_Float, ivit, i_v) {
-            assert(ivit->first < weights->size());
-            w += ivit->second * (*weights)[ivit->first];
-        }
-        parse_scores->push_back(w);
-    }
-
+std::vector<Weights>*
+RerankerModel::scoreNBestLists(const std::vector<sp_sentence_type*>& nbest_lists,
+                               int nthreads) const {
+    std::vector<Weights>* parse_scores = new std::vector<Weights>(nbest_lists.size());
+#ifdef _OPENMP
+    if (nthreads < 1)
+        nthreads = omp_get_max_threads();
+#pragma omp parallel for num_threads(nthreads) schedule(dynamic)
+#endif
+    for (long i = 0; i < (long) nbest_lists.size(); ++i)
+        fcps->parse_scores(*nbest_lists[i], *weights, (*parse_scores)[i]);
     return parse_scores;
 }
 
@@ -96,3 +102,20 @@ sp_sentence_type* readNBestList(const std::string nbest_list, bool lowercase) {
 
     return s;
 }
+
+sp_sentence_type* nbestListFromTrees(
+        const std::vector<std::pair<double, InputTree*> >& scored_trees,
+        bool lowercase) {
+    sp_sentence_type* s = new sp_sentence_type();
+    if (scored_trees.empty()) {
+        return s;
+    }
+    s->parses.resize(scored_trees.size());
+    for (size_t i = 0; i < scored_trees.size(); ++i) {
+        // asNBestList() prints the log probabilities with 10 digits
+        inputtree_parse(s->parses[i], scored_trees[i].first,
+                        scored_trees[i].second, lowercase, 10);
+    }
+    s->set_logcondprob();
+    return s;
+}
@@ -36,6 +36,19 @@ class RerankerModel {
                 const char* feature_weights_filename);
 
         Weights* scoreNBestList(const sp_sentence_type& nbest_list) const;
+        // scores each of nbest_lists on nthreads threads (the OpenMP
+        // default if nthreads < 1); element i holds nbest_lists[i]'s scores
+        std::vector<Weights>* scoreNBestLists(
+                const std::vector<sp_sentence_type*>& nbest_lists,
+                int nthreads) const;
 };
 
 sp_sentence_type* readNBestList(const std::string nbest_list, bool lowercase);
+
+// builds the same n-best list as readNBestList() would from the
+// first-stage SimpleAPI's asNBestList() text for scored_trees, but
+// straight from the trees
+class InputTree;
+sp_sentence_type* nbestListFromTrees(
+        const std::vector<std::pair<double, InputTree*> >& scored_trees,
+        bool lowercase);
@@ -98,15 +98,24 @@ struct sp_parse_type {
   std::istream& read(std::istream& is, bool downcase_flag=false) {
     if (is >> logprob >> parse0) {
       ASSERT(is);
-      ASSERT(finite(logprob));
-      ASSERT(parse0 != NULL);
-      parse0->label.cat = tree::label_type::root();
-      parse = tree_sptree(parse0, downcase_flag);
-      assert(parse != NULL);
+      set(logprob, parse0, downcase_flag);
     }
     return is;
   }  // read_nbest()
 
+  //! set() makes tp (which it takes ownership of) the parse, with log
+  //! probability lp, exactly as if it had been read by read()
+  //
+  void set(Float lp, tree* tp, bool downcase_flag=false) {
+    logprob = lp;
+    parse0 = tp;
+    ASSERT(finite(logprob));
+    ASSERT(parse0 != NULL);
+    parse0->label.cat = tree::label_type::root();
+    parse = tree_sptree(parse0, downcase_flag);
+    assert(parse != NULL);
+  }  // sp_parse_type::set()
+
 };  // sp_parse_type{}
 
 
@@ -423,6 +432,67 @@ struct sp_sentence_type {
 
   }  // sp_sentence_type::read()
 
+  //! skip() reads past the next sentence's parses in parsestream and
+  //! its tree in goldstream without building any trees, so that a
+  //! reader can get to a later sentence cheaply.  The streams are left
+  //! exactly where read() would leave them.
+  //
+  static void skip(std::istream& parsestream, std::istream& goldstream) {
+    std::string label;
+    skip_parses(parsestream, label);
+
+    std::string goldlabel;
+    goldstream >> goldlabel;
+    skip_tree(goldstream);
+
+    if (goldstream && parsestream && (!label.empty()) && label != goldlabel) {
+      std::cerr << HERE << "\n## parse and gold labels don't match: label = " << label 
+		<< ", goldlabel = " << goldlabel << std::endl;
+      std::abort();
+    }
+  }  // sp_sentence_type::skip()
+
+  //! skip_parses() reads past a collection of n-best parses in is as
+  //! read() would, setting label to its sentence identifier.
+  //
+  static std::istream& skip_parses(std::istream& is, std::string& label) {
+    label.clear();
+
+    char c;
+    unsigned nblanklines = 0;
+    while (is.get(c) && isspace(c))
+      if (c == '\n')
+	++nblanklines;
+    
+    if (!is)
+      return is;
+
+    is.unget();
+    
+    if (c == '-' || c == '0') { // Petrov-style Berkeley parser output
+      if (nblanklines == 0) {
+	std::string line;
+	while (getline(is, line))
+	  if (line.find_first_not_of(" \n\r\t") == std::string::npos)
+	    break;
+      }
+      else {
+	while (--nblanklines > 0)
+	  is.putback('\n');
+      }
+    }
+    else { // Charniak-style parser output
+      size_t nparses;
+      if (is >> nparses) {
+	is >> label;
+	Float logprob;
+	for (size_t i = 0; i < nparses && is >> logprob; ++i)
+	  skip_tree(is);
+      }
+    }
+    return is;
+  }  // sp_sentence_type::skip_parses()
+
 };  // sp_sentence_type{}
 
 
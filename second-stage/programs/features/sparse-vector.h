@@ -0,0 +1,84 @@
+// Licensed under the Apache License, Version 2.0 (the "License"); you may
+// not use this file except in compliance with the License.  You may obtain
+// a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations
+// under the License.
+
+// sparse-vector.h -- a sorted vector of (index, value) pairs
+//
+// sparse_vector<I,V> has the parts of the std::map<I,V> interface that
+// the feature classes use to collect feature values (operator[],
+// iteration in index order, clear()), but keeps its elements in one
+// contiguous array.  Collecting a parse's features then costs no node
+// allocations, and once the vector has grown to a sentence's size it
+// is reused for the following sentences.
+//
+// operator[] appends in constant time when the index is larger than any
+// already present, which is the usual case; otherwise it inserts in
+// place.  As with std::vector, inserting invalidates references to
+// other elements.
+
+#ifndef SPARSE_VECTOR_H
+#define SPARSE_VECTOR_H
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+template <typename I, typename V>
+class sparse_vector {
+public:
+  typedef I key_type;
+  typedef V mapped_type;
+  typedef std::pair<I,V> value_type;
+  typedef std::vector<value_type> Elements;
+  typedef typename Elements::size_type size_type;
+  typedef typename Elements::iterator iterator;
+  typedef typename Elements::const_iterator const_iterator;
+
+  iterator begin() { return elements.begin(); }
+  iterator end() { return elements.end(); }
+  const_iterator begin() const { return elements.begin(); }
+  const_iterator end() const { return elements.end(); }
+
+  size_type size() const { return elements.size(); }
+  bool empty() const { return elements.empty(); }
+  void clear() { elements.clear(); }
+  void reserve(size_type n) { elements.reserve(n); }
+
+  //! operator[] returns a reference to index i's value, inserting
+  //! a zero value for i if it is not already present.
+  //
+  V& operator[](const I& i) {
+    if (elements.empty() || elements.back().first < i) {
+      elements.push_back(value_type(i, V()));
+      return elements.back().second;
+    }
+    iterator it = std::lower_bound(elements.begin(), elements.end(), i, key_lessthan());
+    if (it == elements.end() || i < it->first)
+      it = elements.insert(it, value_type(i, V()));
+    return it->second;
+  }  // sparse_vector::operator[]
+
+  //! find() returns an iterator to index i's element, or end()
+  //
+  const_iterator find(const I& i) const {
+    const_iterator it = std::lower_bound(elements.begin(), elements.end(), i, key_lessthan());
+    return (it == elements.end() || i < it->first) ? elements.end() : it;
+  }  // sparse_vector::find()
+
+private:
+  struct key_lessthan {
+    bool operator()(const value_type& e, const I& i) const { return e.first < i; }
+  };
+
+  Elements elements;
+};  // sparse_vector{}
+
+#endif // SPARSE_VECTOR_H
@@ -48,12 +48,17 @@
 // #include <boost/lexical_cast.hpp>
 #include <cassert>
 #include <cstdio>
+#include <cstdlib>
 #include <ext/hash_map>
+#include <fstream>
 #include <iostream>
 #include <limits>
 #include <map>
 #include <set>
+#include <sstream>
 #include <string>
+#include <sys/wait.h>
+#include <unistd.h>
 #include <utility>
 #include <vector>
 
@@ -62,6 +67,7 @@
 #include "sp-data.h"
 #include "heads.h"
 #include "popen.h"
+#include "sparse-vector.h"
 #include "sptree.h"
 #include "sym.h"
 #include "tree.h"
@@ -87,17 +93,31 @@
   }									\
 									\
   virtual void feature_values(const sp_sentence_type& s,		\
-			      Id_Floats& p_i_v)				\
+			      Id_Floats& p_i_v) const			\
   {									\
     feature_values_helper(*this, s, p_i_v);				\
   }                                                                     \
 									\
+  virtual void feature_scores(const sp_sentence_type& s,		\
+			      const Floats& ws, Floats& p_score) const	\
+  {									\
+    feature_scores_helper(*this, s, ws, p_score);			\
+  }                                                                     \
+									\
   virtual std::ostream& print_feature_ids(std::ostream& os) const {	\
     return print_feature_ids_helper(*this, os);				\
   }									\
 									\
   virtual std::istream& read_feature(std::istream& is, Id id) {		\
     return read_feature_helper(*this, is, id);				\
+  }									\
+									\
+  virtual std::ostream& write_feature_counts(std::ostream& os) const {	\
+    return write_feature_counts_helper(*this, os);			\
+  }									\
+									\
+  virtual std::istream& read_feature_count(std::istream& is, Id count) { \
+    return read_feature_count_helper(*this, is, count);		\
   }
 
 
@@ -111,8 +131,9 @@ typedef unsigned int size_type;
 typedef size_type Id;           //!< type of feature Ids
 #define SCANF_ID_TYPE "%u"
 
-typedef std::map<Id,Float> Id_Float;
+typedef sparse_vector<Id,Float> Id_Float;
 typedef std::vector<Id_Float> Id_Floats;
+typedef std::vector<Float> Floats;
 
 ////////////////////////////////////////////////////////////////////////
 //                                                                    //
@@ -167,8 +188,14 @@ public:
 
   //! feature_values() collects the feature values for the sentence s
   //
-  virtual void feature_values(const sp_sentence_type& s, Id_Floats& piv) = 0;
+  virtual void feature_values(const sp_sentence_type& s, Id_Floats& piv) const = 0;
 
+  //! feature_scores() adds to p_score[i] the sum of ws[id] * value over
+  //! the features of parse i of the sentence s.  It computes the same
+  //! values as feature_values(), but never stores them.
+  //
+  virtual void feature_scores(const sp_sentence_type& s, const Floats& ws,
+			      Floats& p_score) const = 0;
 
   //! print_feature_ids() prints out the features and their ids.
   //
@@ -180,6 +207,16 @@ public:
   //
   virtual std::istream& read_feature(std::istream& is, Id id) = 0;
 
+  //! write_feature_counts() writes the features counted so far and
+  //!  their counts.
+  //
+  virtual std::ostream& write_feature_counts(std::ostream& os) const = 0;
+
+  //! read_feature_count() reads the feature definition from in, and
+  //!  adds count to its count.
+  //
+  virtual std::istream& read_feature_count(std::istream& is, Id count) = 0;
+
 
   //! define commonly used symbols
   //
@@ -222,7 +259,7 @@ public:
   //! symbol_quantize() is a utility function mapping positive ints to a
   //! small number of discrete values
   //
-  inline symbol symbol_quantize(int v) {
+  inline symbol symbol_quantize(int v) const {
     static symbol zero("0"), one("1"), two("2"), four("4"), five("5");
     assert(v >= 0);
     switch (v) {
@@ -266,19 +303,25 @@ public:
   };  // FeatureClass::FeatureParseVal{}
 
   //! An IdParseVal object is like a FeatureParseVal object except that
-  //! it maps each feature to its Id first
+  //! it maps each feature to its Id first.  The current parse's values
+  //! are collected in a sparse_vector, and end_parse() appends them to
+  //! f_p_vs, so a sentence's values are gathered without allocating a
+  //! map node per feature and parse.
   //
   template <typename FeatClass>
   struct IdParseVal {
     typedef typename FeatClass::Feature Feature;
     typedef Id F;
     typedef Float V;
-    typedef std::map<size_type,V> C_V;
-    typedef std::map<F,C_V> F_C_V;
+    typedef sparse_vector<F,V> F_V;
+    typedef std::pair<size_type,V> P_V;
+    typedef std::pair<F,P_V> F_P_V;
+    typedef std::vector<F_P_V> F_P_Vs;
 
     FeatClass& fc;
     size_type  parse;
-    F_C_V      f_p_v;
+    F_V        f_v;     // feature -> value for the current parse
+    F_P_Vs     f_p_vs;  // (feature, (parse, value)) for the parses so far
     V	       ignored;
 
     IdParseVal(FeatClass& fc) : fc(fc), ignored(0) { }
@@ -287,12 +330,76 @@ public:
       typedef typename FeatClass::Feature_Id::const_iterator It;
       It it = fc.feature_id.find(f);
       if (it != fc.feature_id.end())
-	return f_p_v[it->second][parse];
+	return f_v[it->second];
       else 
 	return ignored;
     }  // IdParseVal::operator[]
 
+    void clear() {
+      f_v.clear();
+      f_p_vs.clear();
+    }  // IdParseVal::clear()
+
+    //! end_parse() moves the current parse's values into f_p_vs
+    //
+    void end_parse() {
+      cforeach (typename F_V, it, f_v)
+	f_p_vs.push_back(F_P_V(it->first, P_V(parse, it->second)));
+      f_v.clear();
+    }  // IdParseVal::end_parse()
+
   };  // FeatureClass::IdParseVal{}
+
+  //! An IdWeightParseVal object is like an IdParseVal object except
+  //! that it ignores features whose weight in ws is zero.  After L1
+  //! regularization most weights are zero, so most features never
+  //! reach sentence_parsefidvals()' sort.
+  //
+  template <typename FeatClass>
+  struct IdWeightParseVal : public IdParseVal<FeatClass> {
+    typedef IdParseVal<FeatClass> Base;
+    typedef typename Base::Feature Feature;
+    typedef typename Base::V V;
+
+    const Floats& ws;
+
+    IdWeightParseVal(FeatClass& fc, const Floats& ws) : Base(fc), ws(ws) { }
+
+    V& operator[](const Feature& f) {
+      typedef typename FeatClass::Feature_Id::const_iterator It;
+      It it = this->fc.feature_id.find(f);
+      if (it != this->fc.feature_id.end()) {
+	assert(it->second < ws.size());
+	if (ws[it->second] != 0)
+	  return this->f_v[it->second];
+      }
+      return this->ignored;
+    }  // IdWeightParseVal::operator[]
+
+  };  // FeatureClass::IdWeightParseVal{}
+
+  //! A ParseScores object takes the place of an Id_Floats in
+  //! sentence_parsefidvals(); rather than storing value as the
+  //! feature's value in parse i, set_value() adds value * weight
+  //! to parse i's score.
+  //
+  struct ParseScores {
+    const Floats& ws;
+    Floats&       scores;
+
+    ParseScores(const Floats& ws, Floats& scores) : ws(ws), scores(scores) { }
+
+    size_type size() const { return scores.size(); }
+  };  // FeatureClass::ParseScores{}
+
+  static void set_value(Id_Floats& p_i_v, size_type i, Id feat, Float val) {
+    p_i_v[i][feat] = val;
+  }  // FeatureClass::set_value()
+
+  static void set_value(ParseScores& p_s, size_type i, Id feat, Float val) {
+    assert(feat < p_s.ws.size());
+    p_s.scores[i] += val * p_s.ws[feat];
+  }  // FeatureClass::set_value()
       
   //! sentence_parsefidvals() calls parse_featurecount() to get the
   //!  feature count for each parse, then subtracts the most common
@@ -306,45 +413,64 @@ public:
 
     assert(parse_fid_val.size() == s.nparses());
 
-    fid_parse_val.f_p_v.clear();
+    fid_parse_val.clear();
 
     for (size_type i = 0; i < s.nparses(); ++i) {
       fid_parse_val.parse = i;
       fc.parse_featurecount(fc, s.parses[i], fid_parse_val);
+      fid_parse_val.end_parse();
     }
 
-    // copy into parse_fid_val, removing pseudo-constant features
+    // group the values by feature; within a feature they stay in
+    // parse order because the sort is stable
 
     typedef typename Fid_Parse_Val::F F;
     typedef typename Fid_Parse_Val::V V;
-    typedef typename Fid_Parse_Val::C_V C_V;
-    typedef typename Fid_Parse_Val::F_C_V F_C_V;
+    typedef typename Fid_Parse_Val::F_P_Vs F_P_Vs;
+    typedef typename F_P_Vs::const_iterator It;
     typedef std::map<V, size_type> V_C;
 
-    cforeach (typename F_C_V, fit, fid_parse_val.f_p_v) {
+    F_P_Vs& f_p_vs = fid_parse_val.f_p_vs;
+    std::stable_sort(f_p_vs.begin(), f_p_vs.end(), first_lessthan());
+
+    // copy into parse_fid_val, removing pseudo-constant features
+
+    for (It fit = f_p_vs.begin(); fit != f_p_vs.end(); ) {
       const F& feat = fit->first;
-      const C_V& parse_val = fit->second;
+      It fend = fit;
+      while (fend != f_p_vs.end() && fend->first == feat)
+	++fend;
       if (absolute_counts) {
-	for (size_type i = 0; i < s.nparses(); ++i) {
-	  V val = dfind(parse_val, i);
+	for (It it = fit; it != fend; ++it) {
+	  V val = it->second.second;
 	  if (val != 0)
-	    parse_fid_val[i][feat] = val;
+	    set_value(parse_fid_val, it->second.first, feat, val);
 	}
       }
       else {  // relative counts
 	V_C val_gain;  // number of times each feature value occured
-	for (size_type i = 0; i < s.nparses(); ++i) {
-	  const V val = dfind(parse_val, i);
+	for (It it = fit; it != fend; ++it) {
+	  const V val = it->second.second;
 	  val_gain[val] += 2;
 	  val_gain[val-1] += 1;
 	}
+	size_type nzero = s.nparses() - (fend - fit);  // parses without feat
+	if (nzero > 0) {
+	  val_gain[0] += 2*nzero;
+	  val_gain[-1] += nzero;
+	}
 	const V& highest_gain_val = max_element(val_gain, second_lessthan())->first;
+	It it = fit;
 	for (size_type i = 0; i < s.nparses(); ++i) {
-	  const V val = dfind(parse_val, i) - highest_gain_val;
+	  V val = 0;
+	  if (it != fend && it->second.first == i)
+	    val = (it++)->second.second;
+	  val -= highest_gain_val;
 	  if (val != 0)
-	    parse_fid_val[i][feat] = val;
+	    set_value(parse_fid_val, i, feat, val);
 	}
       }
+      fit = fend;
     }
   }  // FeatureClass::sentence_parsefidvals()
 
@@ -432,24 +558,33 @@ public:
 
   //! prune_and_renumber_helper() extracts all features with at
   //! least mincount count, and numbers the remaining features
-  //! incrementally from nextid. 
+  //! incrementally from nextid in the order of their printed
+  //! representations.  Symbols hash and compare by address, so this
+  //! is what makes the ids the same from run to run, and the same
+  //! whether the counts were collected by one process or merged.
   //
   template <typename FeatClass>
   static Id prune_and_renumber_helper(FeatClass& fc, const size_type mincount,
 				      Id nextid, std::ostream& os)
   {
     typedef typename FeatClass::Feature F;
-    typedef std::vector<F> Fs;
-    Fs fs;
+    typedef std::pair<std::string,F> SF;
+    typedef std::vector<SF> SFs;
+    SFs sfs;
 
+    std::ostringstream fos;
     cforeach (typename FeatClass::Feature_Id, it, fc.feature_id) 
-      if (it->second >= mincount) 
-	fs.push_back(it->first);
+      if (it->second >= mincount) {
+	fos.str("");
+	fos << it->first;
+	sfs.push_back(SF(fos.str(), it->first));
+      }
 
     fc.feature_id.clear();
 
-    cforeach (typename Fs, it, fs) 
-      fc.feature_id[*it] = nextid++;
+    std::sort(sfs.begin(), sfs.end(), first_lessthan());
+    cforeach (typename SFs, it, sfs) 
+      fc.feature_id[it->second] = nextid++;
 
     print_feature_ids_helper(fc, os);
     return nextid;
@@ -469,6 +604,23 @@ public:
   } // FeatureClass::feature_values_helper()
 
 
+  //! feature_scores_helper() adds each parse's weighted feature values
+  //! to p_score.  Within a parse, features are added in increasing Id
+  //! order, just as when summing the parse's Id_Float, so the scores
+  //! are bit-for-bit those computed from feature_values().
+  //
+  template <typename FeatClass>
+  static void feature_scores_helper(FeatClass& fc, const sp_sentence_type& s,
+				    const Floats& ws, Floats& p_score)
+  {
+    assert(p_score.size() == s.nparses());
+
+    IdWeightParseVal<FeatClass> i_p_v(fc, ws);
+    ParseScores p_s(ws, p_score);
+    sentence_parsefidvals(fc, s, i_p_v, p_s);
+  } // FeatureClass::feature_scores_helper()
+
+
   //! read_feature_helper() reads the next feature from is, and
   //! sets its id to id.  This method reads the entire rest of the
   //! line and defines the feature accordingly.
@@ -492,6 +644,36 @@ public:
     return is;
   }  // FeatureClass::read_feature_helper()
 
+
+  //! write_feature_counts_helper() writes the counted features in the
+  //! same format as the feature ids, but with counts in place of ids.
+  //
+  template <typename FeatClass>
+  static std::ostream& write_feature_counts_helper(const FeatClass& fc, 
+						   std::ostream& os) {
+    cforeach (typename FeatClass::Feature_Id, it, fc.feature_id)
+      os << it->second
+	 << '\t' << fc.identifier() 
+	 << ' ' << it->first
+	 << '\n';
+    return os;
+  }  // FeatureClass::write_feature_counts_helper()
+
+
+  //! read_feature_count_helper() reads the next feature from is, and
+  //! adds count to its count.
+  //
+  template <typename FeatClass>
+  static std::istream&
+  read_feature_count_helper(FeatClass& fc, std::istream& is, Id count)
+  {
+    typename FeatClass::Feature f;
+    is >> f;
+    assert(is);
+    fc.feature_id[f] += count;
+    return is;
+  }  // FeatureClass::read_feature_count_helper()
+
 };  // FeatureClass{}
 
 
@@ -516,6 +698,11 @@ public:
 class FeatureClassPtrs : public std::vector<FeatureClass*> {
 
 private:
+  static void remove_files(const std::vector<std::string>& files) {
+    cforeach (std::vector<std::string>, it, files)
+      unlink(it->c_str());
+  }  // FeatureClassPtrs::remove_files()
+
   struct extract_features_visitor {
     struct FeatureClassPtrs& fcps;
 
@@ -545,13 +732,153 @@ public:
   inline void features_nlogp();
 
   //! extract_features() extracts features from the tree file infile.
+  //! If njobs > 1 the sentences are split into njobs contiguous shards
+  //! that are counted in parallel by child processes, and their counts
+  //! are then merged.
   //
-  void extract_features(const char* parseincmd, const char* goldincmd) {
-    extract_features_visitor efv(*this);
-    sp_corpus_type::map_sentences_cmd(parseincmd, goldincmd, efv, lowercase_flag);
+  void extract_features(const char* parseincmd, const char* goldincmd,
+			unsigned njobs=1) {
+    if (njobs <= 1) {
+      extract_features_visitor efv(*this);
+      sp_corpus_type::map_sentences_cmd(parseincmd, goldincmd, efv, lowercase_flag);
+      return;
+    }
+
+    const char* tmpdir = getenv("TMPDIR");
+    std::vector<std::string> countfiles;
+    for (unsigned shard = 0; shard < njobs; ++shard) {
+      std::string tmpl(tmpdir ? tmpdir : "/tmp");
+      tmpl += "/extract-spfeatures.XXXXXX";
+      std::vector<char> name(tmpl.begin(), tmpl.end());
+      name.push_back('\0');
+      int fd = mkstemp(&name[0]);
+      if (fd < 0) {
+	std::cerr << "## Error: can't create temporary file " << tmpl << std::endl;
+	remove_files(countfiles);
+	exit(EXIT_FAILURE);
+      }
+      close(fd);
+      countfiles.push_back(&name[0]);
+    }
+
+    std::cout << std::flush;
+    std::cerr << std::flush;
+    std::vector<pid_t> pids;
+    for (unsigned shard = 0; shard < njobs; ++shard) {
+      pid_t pid = fork();
+      if (pid < 0) {
+	std::cerr << "## Error: can't fork shard " << shard << std::endl;
+	break;
+      }
+      if (pid == 0) {
+	extract_shard_features(parseincmd, goldincmd, shard, njobs);
+	std::ofstream os(countfiles[shard].c_str());
+	write_feature_counts(os);
+	os.close();
+	_exit(os ? EXIT_SUCCESS : EXIT_FAILURE);
+      }
+      pids.push_back(pid);
+    }
+
+    bool failed = (pids.size() != njobs);
+    for (unsigned shard = 0; shard < pids.size(); ++shard) {
+      int status;
+      if (waitpid(pids[shard], &status, 0) != pids[shard]
+	  || !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) {
+	std::cerr << "## Error: shard " << shard << " failed to count features" << std::endl;
+	failed = true;
+      }
+    }
+    
+    for (unsigned shard = 0; !failed && shard < njobs; ++shard) {
+      std::ifstream is(countfiles[shard].c_str());
+      read_feature_counts(is);
+      if (is.bad()) {
+	std::cerr << "## Error: can't read feature counts from " << countfiles[shard] << std::endl;
+	failed = true;
+      }
+    }
+
+    remove_files(countfiles);
+    if (failed)
+      exit(EXIT_FAILURE);
   }  // FeatureClassPtrs::extract_features()
 
 
+  //! extract_shard_features() extracts features from shard of the
+  //! nshards contiguous blocks of sentences in the tree files.
+  //
+  void extract_shard_features(const char* parseincmd, const char* goldincmd,
+			      unsigned shard, unsigned nshards) {
+    ipstream parsein(parseincmd);
+    if (!parsein) {
+      std::cerr << "## Error: can't popen parseincmd = " << parseincmd << std::endl;
+      exit(EXIT_FAILURE);
+    }
+    ipstream goldin(goldincmd);
+    if (!goldin) {
+      std::cerr << "## Error: can't popen goldincmd = " << goldincmd << std::endl;
+      exit(EXIT_FAILURE);
+    }
+    size_t nsentences;
+    if (!(goldin >> nsentences)) {
+      std::cerr << "## Failed to read nsentences from " 
+		<< goldincmd << std::endl;
+      exit(EXIT_FAILURE);
+    }
+    size_t begin = nsentences * shard / nshards;
+    size_t end = nsentences * (shard + 1) / nshards;
+    extract_features_visitor efv(*this);
+    sp_sentence_type sentence;
+    for (size_t i = 0; i < end; ++i) {   // sentences after end aren't read
+      if (i < begin)                     // nor are trees built for those before begin
+	sp_sentence_type::skip(parsein, goldin);
+      else
+	sentence.read(parsein, goldin, lowercase_flag);
+      if (!parsein || !goldin) {
+	std::cerr << "## Error: failed to read sentence " << i 
+		  << ", nsentences = " << nsentences << std::endl;
+	exit(EXIT_FAILURE);
+      }
+      if (i >= begin)
+	efv(sentence);
+    }
+  }  // FeatureClassPtrs::extract_shard_features()
+
+
+  //! write_feature_counts() writes the feature counts to os.
+  //
+  void write_feature_counts(std::ostream& os) const {
+    cforeach (FeatureClassPtrs, it, *this)
+      (*it)->write_feature_counts(os);
+  }  // FeatureClassPtrs::write_feature_counts()
+
+
+  //! read_feature_counts() reads feature counts written by
+  //! write_feature_counts() from is, and adds them to each feature
+  //! class' counts.
+  //
+  void read_feature_counts(std::istream& is) {
+    typedef std::map<std::string, FeatureClass*> St_FCp;
+    St_FCp fcident_fcp;
+    for (iterator it = begin(); it != end(); ++it) 
+      fcident_fcp[(*it)->identifier()] = *it;
+
+    Id count;
+    std::string fcident;
+    while (is >> count >> fcident) {
+      St_FCp::const_iterator it = fcident_fcp.find(fcident);
+      if (it == fcident_fcp.end()) {
+	std::cerr << "## Error: can't find feature identifier " << fcident
+		  << " in feature list." << std::endl;
+	exit(EXIT_FAILURE);
+      }
+      it->second->read_feature_count(is, count);
+      is.ignore(std::numeric_limits<int>::max(), '\n');
+    }
+  }  // FeatureClassPtrs::read_feature_counts()
+
+
   //! prune_and_renumber() prunes all features that occur in less than
   //! mincount sentences, and then assigns them a number starting at 1.
   //
@@ -570,18 +897,11 @@ public:
   void write_features(const char* parseincmd, const char* goldincmd,
 		      const char* outfile) {
 
-    const char* filesuffix = strrchr(outfile, '.');
-    std::string command(strcasecmp(filesuffix, ".bz2") 
-			? (strcasecmp(filesuffix, ".gz") 
-			   ? "cat > " : "gzip > ")
-			: "bzip2 > ");
-    command += outfile;
-    FILE *out = popen(command.c_str(), "w");
+    FILE *out = zfopen(outfile, "w");  // compressed in-process if .gz or .bz2
     if (out == NULL) {
-      std::cerr << "## Error: can't popen command " << command << std::endl;
+      std::cerr << "## Error: can't open outfile " << outfile << std::endl;
       exit(EXIT_FAILURE);
     }
-    command.clear();
 
     ipstream parsein(parseincmd);
 
@@ -631,7 +951,7 @@ public:
       fprintf(out, "\n");
     }
 
-    pclose(out);
+    fclose(out);
   }  // FeatureClassPtrs::write_features()
 
   //! read_feature_ids() reads feature ids from is, and sets
@@ -664,25 +984,31 @@ public:
     return maxid;
   }  // FeatureClassPtrs::read_feature_ids()
 
+  //! parse_scores() sets scores[i] to the weighted sum of the feature
+  //! values of parse i, without building the parses' feature vectors.
+  //! Feature classes number their features consecutively in the order
+  //! they appear here, so each parse's values are still summed in
+  //! increasing Id order.
+  //
+  void parse_scores(const sp_sentence_type& sentence, const Floats& ws,
+		    Floats& scores) const {
+    scores.assign(sentence.nparses(), 0);
+    cforeach (FeatureClassPtrs, it, *this)
+      (*it)->feature_scores(sentence, ws, scores);
+  }  // FeatureClassPtrs::parse_scores()
+
   //! best_parse() returns the best parse tree from n-best parses for a sentence
   //
-  template <typename Ws>
-  const tree* best_parse(const sp_sentence_type& sentence, const Ws& ws) const {
+  const tree* best_parse(const sp_sentence_type& sentence, const Floats& ws) const {
     assert(sentence.nparses() > 0);
 
-    Id_Floats p_i_v(sentence.nparses());
-    cforeach (FeatureClassPtrs, it, *this)
-      (*it)->feature_values(sentence, p_i_v);
+    Floats scores;
+    parse_scores(sentence, ws, scores);
 
     Float max_weight = 0;
     size_type i_max = 0;
     for (size_type i = 0; i < sentence.nparses(); ++i) {
-      const Id_Float& i_v = p_i_v[i];
-      Float w = 0;
-      cforeach (Id_Float, ivit, i_v) {
-	assert(ivit->first < ws.size());
-	w += ivit->second * ws[ivit->first];
-      }
+      Float w = scores[i];
       if (i == 0 || w > max_weight) {
 	i_max = i;
 	max_weight = w;
@@ -695,16 +1021,14 @@ public:
   //! write_ranked_trees() sorts all of the trees by their conditional
   //! probability and then writes them out in sorted order.
   //
-  template <typename Ws>
   std::ostream& write_ranked_trees(const sp_sentence_type& sentence, 
-				   const Ws& ws, std::ostream& os) const {
+				   const Floats& ws, std::ostream& os) const {
     assert(sentence.nparses() > 0);
 
     os << sentence.nparses() << ' ' << sentence.label << std::endl;
 
-    Id_Floats p_i_v(sentence.nparses());
-    cforeach (FeatureClassPtrs, it, *this)
-      (*it)->feature_values(sentence, p_i_v);
+    Floats scores;
+    parse_scores(sentence, ws, scores);
 
     typedef std::pair<Id,Float> IdFloat;
     typedef std::vector<IdFloat> IdFloats;
@@ -713,13 +1037,7 @@ public:
 
     for (size_type i = 0; i < sentence.nparses(); ++i) {
       idweights[i].first = i;
-      const Id_Float& i_v = p_i_v[i];
-      Float w = 0;
-      cforeach (Id_Float, ivit, i_v) {
-	assert(ivit->first < ws.size());
-	w += ivit->second * ws[ivit->first];
-      }
-      idweights[i].second = w;
+      idweights[i].second = scores[i];
     }
 
     std::sort(idweights.begin(), idweights.end(), second_greaterthan());
@@ -788,7 +1106,7 @@ public:
 
   template <typename FeatClass, typename Feat_Count>
   void parse_featurecount(FeatClass& fc, const sp_parse_type& parse,
-			  Feat_Count& feat_count) {
+			  Feat_Count& feat_count) const {
     feat_count[0] -= parse.logprob;
   }  // NLogP::parse_featurecount();
 
@@ -820,7 +1138,7 @@ public:
 
   template <typename FeatClass, typename Feat_Count>
   void parse_featurecount(FeatClass& fc, const sp_parse_type& parse,
-			  Feat_Count& feat_count) {
+			  Feat_Count& feat_count) const {
     feat_count[0] -= parse.logcondprob;
   }  // LogCondP::parse_featurecount();
 
@@ -862,7 +1180,7 @@ public:
 
   template <typename FeatClass, typename Feat_Count>
   void parse_featurecount(FeatClass& fc, const sp_parse_type& parse,
-			  Feat_Count& feat_count) {
+			  Feat_Count& feat_count) const {
     int bin = std::max(1, std::min(nbins, int(-parse.logcondprob/log_base)));
     ++feat_count[bin];
   }  // BinnedLogCondP::parse_featurecount();
@@ -905,7 +1223,7 @@ public:
 
   template <typename FeatClass, typename Feat_Count>
   void parse_featurecount(FeatClass& fc, const sp_parse_type& parse,
-			  Feat_Count& feat_count) {
+			  Feat_Count& feat_count) const {
     int bin = std::max(1, std::min(nbins, int(-parse.logcondprob/log_base)));
     feat_count[bin] += -parse.logcondprob/log_base;
   }  // InterpLogCondP::parse_featurecount();
@@ -1021,7 +1339,7 @@ public:
   //! push_child_features() pushes the features for this child node 
   //
   void push_child_features(const sptree* node, const sptree* parent, Feature& f,
-			   annotation_level& highest_level) 
+			   annotation_level& highest_level) const 
   {
     const sptree* parent_headchild
       = (type == semantic 
@@ -1053,7 +1371,7 @@ public:
 
   //! push_ancestor_features() pushes features for ancestor nodes.
   //
-  void push_ancestor_features(const sptree* node, Feature& f) {
+  void push_ancestor_features(const sptree* node, Feature& f) const {
 
     f.push_back(endmarker());
     
@@ -1108,7 +1426,7 @@ public:
 
   template <typename FeatClass, typename Feat_Count>
   void node_featurecount(FeatClass& fc, const sptree* node, 
-			 Feat_Count& feat_count) {
+			 Feat_Count& feat_count) const {
 
     if (!node->is_nonterminal())
       return;
@@ -1172,7 +1490,7 @@ public:
   size_type fraglen;
 
   template <typename FeatClass, typename Feat_Count>
-  void node_featurecount(FeatClass& fc, const sptree* node, Feat_Count& feat_count) 
+  void node_featurecount(FeatClass& fc, const sptree* node, Feat_Count& feat_count) const 
   {
     if (!node->is_nonterminal())
       return;
@@ -1260,7 +1578,7 @@ public:
   bool headdir, headdist;
 
   template <typename FeatClass, typename Feat_Count>
-  void node_featurecount(FeatClass& fc, const sptree* node, Feat_Count& feat_count) 
+  void node_featurecount(FeatClass& fc, const sptree* node, Feat_Count& feat_count) const 
   {
     if (!node->is_nonterminal())
       return;
@@ -1367,7 +1685,7 @@ public:
   
   template <typename FeatClass, typename Feat_Count>
   void node_featurecount(FeatClass& fc, const sptree* node, 
-			 Feat_Count& feat_count) {
+			 Feat_Count& feat_count) const {
 
     if (!node->is_preterminal())
       return;
@@ -1425,7 +1743,7 @@ public:
   
   template <typename FeatClass, typename Feat_Count>
   void node_featurecount(FeatClass& fc, const sptree* node, 
-			 Feat_Count& feat_count) {
+			 Feat_Count& feat_count) const {
 
     if (node->is_punctuation() || !node->is_preterminal())
       return;
@@ -1650,7 +1968,7 @@ public:
   //
   template <typename FeatClass, typename Feat_Count>
   void node_featurecount(FeatClass& fc, const sptree* node, 
-			 Feat_Count& feat_count) 
+			 Feat_Count& feat_count) const 
   {
     if (!node->is_preterminal())  // only consider preterminal heads
       return;
@@ -1669,7 +1987,7 @@ public:
   //
   template <typename Feat_Count>
   void visit_ancestors(Feat_Count& feat_count, const sptree* node,
-		       size_type nsofar, Feature& f) {
+		       size_type nsofar, Feature& f) const {
     if (nsofar == nheads) {  // are we done?
       ++feat_count[f];
       return;
@@ -1694,7 +2012,7 @@ public:
   //
   template <typename Feat_Count>
   void visit_descendants(Feat_Count& feat_count, const sptree* ancestor,
-			 size_type nsofar, Feature& f, const sptree* head)
+			 size_type nsofar, Feature& f, const sptree* head) const
   {
     if (head->is_preterminal()) {
       f.push_back(head->label.cat);      // push governor label
@@ -1807,7 +2125,7 @@ public:
 
   template <typename FeatClass, typename Feat_Count>
   void node_featurecount(FeatClass& fc, const SptreePtrs& preterms,
-			 const sptree* node, Feat_Count& feat_count)
+			 const sptree* node, Feat_Count& feat_count) const
   {
     if (!node->is_nonterminal())
       return;
@@ -1875,7 +2193,7 @@ public:
 
   template <typename FeatClass, typename Feat_Count>
   void node_featurecount(FeatClass& fc, const SptreePtrs& preterms,
-			 const sptree* node, Feat_Count& feat_count)
+			 const sptree* node, Feat_Count& feat_count) const
   {
     if (!node->is_nonterminal())
       return;
@@ -1945,7 +2263,7 @@ public:
 
   template <typename FeatClass, typename Feat_Count>
   void node_featurecount(FeatClass& fc, const SptreePtrs& preterms,
-			 const sptree* node, Feat_Count& feat_count)
+			 const sptree* node, Feat_Count& feat_count) const
   {
     if (!node->is_nonterminal())
       return;
@@ -2013,7 +2331,7 @@ public:
 
   template <typename FeatClass, typename Feat_Count>
   void node_featurecount(FeatClass& fc, const SptreePtrs& preterms,
-			 const sptree* node, Feat_Count& feat_count)
+			 const sptree* node, Feat_Count& feat_count) const
   {
     if (!node->is_nonterminal())
       return;
@@ -2067,7 +2385,7 @@ public:
 
   template <typename FeatClass, typename Feat_Count>
   void node_featurecount(FeatClass& fc, const SptreePtrs& preterms,
-			 const sptree* node, Feat_Count& feat_count)
+			 const sptree* node, Feat_Count& feat_count) const
   {
     if (!node->is_nonterminal())
       return;
@@ -2135,7 +2453,7 @@ public:
   }  // NGramTree::NGramTree()
 
   tree* selective_copy(const sptree* sp, size_type left, size_type right, 
-		       bool copy_next = false) 
+		       bool copy_next = false) const 
   {
     const sptree_label& label = sp->label;
 
@@ -2163,7 +2481,7 @@ public:
 
   template <typename FeatClass, typename Feat_Count>
   void tree_featurecount(FeatClass& fc, const sptree* root, 
-			 Feat_Count& feat_count) {
+			 Feat_Count& feat_count) const {
     if (debug_level >= 10000)
       std::cerr << "# root = " << root << std::endl;
     std::vector<const sptree*> preterms;
@@ -2230,7 +2548,7 @@ public:
     identifier_string += lexical_cast<std::string>(htype);
   }  // HeadTree::HeadTree()
 
-  tree* selective_copy(const sptree* sp, unsigned int headleft) 
+  tree* selective_copy(const sptree* sp, unsigned int headleft) const 
   {
     if (!sp)
       return NULL;
@@ -2254,7 +2572,7 @@ public:
 
   template <typename FeatClass, typename Feat_Count>
   void tree_featurecount(FeatClass& fc, const sptree* root, 
-			 Feat_Count& feat_count) {
+			 Feat_Count& feat_count) const {
     if (debug_level >= 20000)
       std::cerr << "# root = " << root << std::endl;
     std::vector<const sptree*> preterms;
@@ -2306,7 +2624,7 @@ public:
 
   template <typename FeatClass, typename Feat_Count>
   void node_featurecount(FeatClass& fc, const sptree* node, 
-			 Feat_Count& feat_count) 
+			 Feat_Count& feat_count) const 
   {
     if ((node->label.cat != S() && node->label.cat != SINV()) 
 	|| node->label.syntactic_lexhead == NULL)
@@ -2355,7 +2673,7 @@ public:
 
   template <typename FeatClass, typename Feat_Count>
   void node_featurecount(FeatClass& fc, const sptree* node, 
-			 Feat_Count& feat_count) 
+			 Feat_Count& feat_count) const 
   {
     const sptree_label& label = node->label;
 
@@ -2417,7 +2735,7 @@ public:
 
   template <typename FeatClass, typename Feat_Count>
   void node_featurecount(FeatClass& fc, const sptree* node, 
-			 Feat_Count& feat_count) 
+			 Feat_Count& feat_count) const 
   {
     if (!node->is_coordination())
       return;
@@ -2502,7 +2820,7 @@ public:
 
   template <typename FeatClass, typename Feat_Count>
   void node_featurecount(FeatClass& fc, const sptree* node, 
-			 Feat_Count& feat_count) 
+			 Feat_Count& feat_count) const 
   {
     if (!node->is_coordination())
       return;
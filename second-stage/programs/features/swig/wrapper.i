@@ -19,6 +19,7 @@
 %include "std_except.i"
 %include "std_vector.i"
 %include "std_string.i"
+%include "std_pair.i"
 %include "exception.i"
 
 #ifdef SWIGPYTHON
@@ -42,7 +43,32 @@
 }
 
 %newobject readNBestList;
+%newobject nbestListFromTrees;
 %newobject scoreNBestList;
+%newobject scoreNBestLists;
+
+#ifdef SWIGPYTHON
+// scoring doesn't touch any Python objects, so let other Python
+// threads run meanwhile.  A RerankerError is only turned into a Python
+// exception once we hold the GIL again.
+%exception RerankerModel::scoreNBestLists {
+    {
+        bool failed = false;
+        std::string message;
+        Py_BEGIN_ALLOW_THREADS
+        try {
+            $action
+        } catch (RerankerError re) {
+            failed = true;
+            message = re.description;
+        }
+        Py_END_ALLOW_THREADS
+        if (failed) {
+            SWIG_exception(SWIG_RuntimeError, message.c_str());
+        }
+    }
+}
+#endif
 
 %inline {
     #include <cstddef>
@@ -64,6 +90,12 @@
     };
     sp_sentence_type* readNBestList(const std::string nbest_list, bool lowercase);
 
+    // the first-stage parser's trees (from its SWIG module)
+    class InputTree;
+    sp_sentence_type* nbestListFromTrees(
+            const std::vector<std::pair<double, InputTree*> >& scored_trees,
+            bool lowercase);
+
     class RerankerModel {
         public:
             Id maxid;
@@ -72,9 +104,15 @@
                     const char* feature_ids_filename,
                     const char* feature_weights_filename);
             Weights* scoreNBestList(const sp_sentence_type& nbest_list) const;
+            std::vector<Weights>* scoreNBestLists(
+                    const std::vector<sp_sentence_type*>& nbest_lists,
+                    int nthreads) const;
     };
 
     void setOptions(int debug, bool abs_counts);
 }
 
 %template(Weights) std::vector<Float>;
+%template(WeightsVector) std::vector<Weights>;
+%template(NBestListVector) std::vector<sp_sentence_type*>;
+%template(ScoredTrees) std::vector<std::pair<double, InputTree*> >;
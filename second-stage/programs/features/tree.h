@@ -109,6 +109,8 @@
 // hash<tree_node>{}
 // hash<tree_node*>{}
 //
+// skip_tree()
+//
 // tree
 //
 // readtree_lineno
@@ -1021,6 +1023,28 @@ std::istream& operator>> (std::istream& is, tree_node<label_type>*& tp) {
   return is;
 }
 
+//! skip_tree() reads past a tree on is exactly as operator>> would,
+//! but without building it.
+//
+inline std::istream& skip_tree(std::istream& is) {
+  char c;
+  if (is >> c) {
+    if (c == '(') {
+      for (unsigned depth = 1; depth > 0 && is.get(c); )
+	if (c == '(')
+	  ++depth;
+	else if (c == ')')
+	  --depth;
+    }
+    else if (c != ')') {
+      is.unget();
+      tree_label label;
+      is >> label;
+    }
+  }
+  return is;
+}  // skip_tree()
+
 typedef tree_node<> tree;
 
 
@@ -0,0 +1,452 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+/* zfile.h
+ *
+ * In-process reading and writing of gzip and bzip2 compressed files
+ * through ordinary stdio FILE*s, so that compressed data doesn't have
+ * to be piped through a zcat or bzcat process.  It can be included
+ * from both C and C++, and needs -lz -lbz2 when linking.
+ *
+ *  zfopen(filename, mode) opens filename for reading (mode "r") or
+ *   writing (mode "w").  It is decompressed or compressed with zlib
+ *   if its name ends in .gz, with libbz2 if it ends in .bz2, and is
+ *   read or written as is otherwise.
+ *
+ *  zpopen(command) returns a FILE* that reads the output of the shell
+ *   command.  Commands that just decompress or concatenate files, i.e.,
+ *   "cat", "zcat", "gunzip -c" or "bzcat" followed by filenames (which
+ *   may contain the glob characters *, ? and [), are run in-process;
+ *   anything else is popen'd.
+ *
+ * Either way the FILE* must be closed with fclose(), not pclose().
+ */
+
+#ifndef ZFILE_H
+#define ZFILE_H
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE            /* for fopencookie() */
+#endif
+
+#include <bzlib.h>
+#include <glob.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/types.h>
+#include <zlib.h>
+
+enum zfile_kind { ZFILE_PLAIN, ZFILE_GZIP, ZFILE_BZIP2, ZFILE_PIPE };
+
+/*! A zfile_cookie reads the files in its list one after the other, or
+ *! writes a single file.
+ */
+
+typedef struct zfile_cookie {
+  enum zfile_kind kind;        /* kind of the files in files[] */
+  char **files;                /* files still to be read */
+  size_t nfiles, next;         /* number of files, index of next one */
+  enum zfile_kind open_kind;   /* kind of the currently open file */
+  FILE *fp;                    /* plain or bzip2 file, or popen'd pipe */
+  gzFile gz;                   /* gzip file */
+  BZFILE *bz;                  /* bzip2 stream on fp */
+  int writing;
+} zfile_cookie;
+
+static inline enum zfile_kind zfile_suffix_kind(const char *filename) {
+  const char *filesuffix = strrchr(filename, '.');
+  if (filesuffix == NULL)
+    return ZFILE_PLAIN;
+  if (strcasecmp(filesuffix, ".gz") == 0)
+    return ZFILE_GZIP;
+  if (strcasecmp(filesuffix, ".bz2") == 0)
+    return ZFILE_BZIP2;
+  return ZFILE_PLAIN;
+}  /* zfile_suffix_kind() */
+
+static inline void zfile_free(zfile_cookie *z) {
+  size_t i;
+  for (i = 0; i < z->nfiles; ++i)
+    free(z->files[i]);
+  free(z->files);
+  free(z);
+}  /* zfile_free() */
+
+/*! zfile_close_current() closes the file currently being read or
+ *! written, returning 0 on success.
+ */
+
+static inline int zfile_close_current(zfile_cookie *z) {
+  int status = 0, bzerror = BZ_OK;
+  switch (z->open_kind) {
+  case ZFILE_GZIP:
+    if (z->gz != NULL)
+      status = (gzclose(z->gz) == Z_OK) ? 0 : -1;
+    z->gz = NULL;
+    break;
+  case ZFILE_BZIP2:
+    if (z->bz != NULL) {
+      if (z->writing)
+	BZ2_bzWriteClose(&bzerror, z->bz, 0, NULL, NULL);
+      else
+	BZ2_bzReadClose(&bzerror, z->bz);
+      if (bzerror != BZ_OK)
+	status = -1;
+    }
+    z->bz = NULL;
+    /* fall through */
+  case ZFILE_PLAIN:
+    if (z->fp != NULL && fclose(z->fp) != 0)
+      status = -1;
+    z->fp = NULL;
+    break;
+  case ZFILE_PIPE:
+    if (z->fp != NULL)
+      pclose(z->fp);               /* as before, ignore its exit status */
+    z->fp = NULL;
+    break;
+  }
+  return status;
+}  /* zfile_close_current() */
+
+/*! zfile_open_next() opens the next file to be read, returning 0 on
+ *! success, 1 if there are no more files and -1 on error.
+ */
+
+static inline int zfile_open_next(zfile_cookie *z) {
+  const char *filename;
+  int bzerror;
+  if (z->next >= z->nfiles)
+    return 1;
+  filename = z->files[z->next++];
+  z->open_kind = z->kind;
+  switch (z->kind) {
+  case ZFILE_GZIP:
+    z->gz = gzopen(filename, "rb");
+    if (z->gz == NULL)
+      break;
+    gzbuffer(z->gz, 1 << 17);
+    return 0;
+  case ZFILE_BZIP2:
+    z->fp = fopen(filename, "rb");
+    if (z->fp == NULL)
+      break;
+    z->bz = BZ2_bzReadOpen(&bzerror, z->fp, 0, 0, NULL, 0);
+    if (bzerror != BZ_OK)
+      break;
+    return 0;
+  case ZFILE_PLAIN:
+    z->fp = fopen(filename, "rb");
+    if (z->fp == NULL)
+      break;
+    return 0;
+  case ZFILE_PIPE:
+    z->fp = popen(filename, "r");
+    if (z->fp == NULL)
+      break;
+    return 0;
+  }
+  fprintf(stderr, "## Error in zfile.h: can't open %s\n", filename);
+  zfile_close_current(z);
+  return -1;
+}  /* zfile_open_next() */
+
+/*! zfile_bzread() reads from a bzip2 file, carrying on into the next
+ *! stream if the file contains several (as pbzip2 writes).
+ */
+
+static inline ssize_t zfile_bzread(zfile_cookie *z, char *buf, size_t size) {
+  int bzerror, nunused, n;
+  void *unused;
+  char saved[BZ_MAX_UNUSED];
+  for (;;) {
+    n = BZ2_bzRead(&bzerror, z->bz, buf, (int) size);
+    if (bzerror == BZ_OK)
+      return n;
+    if (bzerror != BZ_STREAM_END)
+      return -1;
+    BZ2_bzReadGetUnused(&bzerror, z->bz, &unused, &nunused);
+    if (bzerror != BZ_OK)
+      return -1;
+    memcpy(saved, unused, nunused);
+    BZ2_bzReadClose(&bzerror, z->bz);
+    z->bz = NULL;
+    if (nunused == 0) {
+      int c = getc(z->fp);
+      if (c == EOF)
+	return n;                  /* end of the last stream */
+      saved[nunused++] = c;
+    }
+    z->bz = BZ2_bzReadOpen(&bzerror, z->fp, 0, 0, saved, nunused);
+    if (bzerror != BZ_OK)
+      return -1;
+    if (n > 0)
+      return n;
+  }
+}  /* zfile_bzread() */
+
+static inline ssize_t zfile_read(void *cookie, char *buf, size_t size) {
+  zfile_cookie *z = (zfile_cookie *) cookie;
+  ssize_t n;
+  int status;
+  if (size > (1U << 30))
+    size = 1U << 30;
+  for (;;) {
+    if (z->gz == NULL && z->fp == NULL) {
+      status = zfile_open_next(z);
+      if (status != 0)
+	return (status > 0) ? 0 : -1;
+    }
+    switch (z->open_kind) {
+    case ZFILE_GZIP:
+      n = gzread(z->gz, buf, (unsigned) size);
+      break;
+    case ZFILE_BZIP2:
+      n = (z->bz == NULL) ? 0 : zfile_bzread(z, buf, size);
+      break;
+    default:
+      n = fread(buf, 1, size, z->fp);
+      if (n == 0 && ferror(z->fp))
+	n = -1;
+      break;
+    }
+    if (n != 0)
+      return n;
+    if (zfile_close_current(z) != 0)
+      return -1;
+  }
+}  /* zfile_read() */
+
+static inline ssize_t zfile_write(void *cookie, const char *buf, size_t size) {
+  zfile_cookie *z = (zfile_cookie *) cookie;
+  int bzerror;
+  size_t n = size;
+  while (n > 0) {
+    unsigned chunk = (n > (1U << 30)) ? (1U << 30) : (unsigned) n;
+    switch (z->open_kind) {
+    case ZFILE_GZIP:
+      if (gzwrite(z->gz, buf, chunk) != (int) chunk)
+	return -1;
+      break;
+    case ZFILE_BZIP2:
+      BZ2_bzWrite(&bzerror, z->bz, (void *) buf, (int) chunk);
+      if (bzerror != BZ_OK)
+	return -1;
+      break;
+    default:
+      if (fwrite(buf, 1, chunk, z->fp) != chunk)
+	return -1;
+      break;
+    }
+    buf += chunk;
+    n -= chunk;
+  }
+  return size;
+}  /* zfile_write() */
+
+static inline int zfile_close(void *cookie) {
+  zfile_cookie *z = (zfile_cookie *) cookie;
+  int status = zfile_close_current(z);
+  zfile_free(z);
+  return status;
+}  /* zfile_close() */
+
+#ifdef __GLIBC__
+
+static inline FILE *zfile_fopen_cookie(zfile_cookie *z, const char *mode) {
+  cookie_io_functions_t io;
+  io.read = zfile_read;
+  io.write = zfile_write;
+  io.seek = NULL;
+  io.close = zfile_close;
+  return fopencookie(z, mode, io);
+}  /* zfile_fopen_cookie() */
+
+#else /* BSD and OS X */
+
+static inline int zfile_funread(void *cookie, char *buf, int size) {
+  return (int) zfile_read(cookie, buf, size);
+}
+
+static inline int zfile_funwrite(void *cookie, const char *buf, int size) {
+  return (int) zfile_write(cookie, buf, size);
+}
+
+static inline FILE *zfile_fopen_cookie(zfile_cookie *z, const char *mode) {
+  return (mode[0] == 'w')
+    ? funopen(z, NULL, zfile_funwrite, NULL, zfile_close)
+    : funopen(z, zfile_funread, NULL, NULL, zfile_close);
+}  /* zfile_fopen_cookie() */
+
+#endif /* __GLIBC__ */
+
+/*! zfile_new() returns a cookie of the given kind with no files */
+
+static inline zfile_cookie *zfile_new(enum zfile_kind kind, size_t maxnfiles) {
+  zfile_cookie *z = (zfile_cookie *) calloc(1, sizeof(zfile_cookie));
+  z->files = (char **) calloc(maxnfiles + 1, sizeof(char *));
+  z->kind = z->open_kind = kind;
+  return z;
+}  /* zfile_new() */
+
+static inline void zfile_push(zfile_cookie *z, const char *file, size_t *maxnfiles) {
+  if (z->nfiles >= *maxnfiles) {
+    *maxnfiles = 2 * *maxnfiles + 1;
+    z->files = (char **) realloc(z->files, (*maxnfiles + 1) * sizeof(char *));
+  }
+  z->files[z->nfiles++] = strdup(file);
+}  /* zfile_push() */
+
+/*! zfopen() opens filename for reading (mode "r") or writing (mode "w"),
+ *! decompressing or compressing it according to its suffix.  It returns
+ *! NULL if the file can't be opened.  Uncompressed files are just
+ *! fopen'd, so they can still be fstat'd and mmap'd.
+ */
+
+static inline FILE *zfopen(const char *filename, const char *mode) {
+  size_t maxnfiles = 1;
+  zfile_cookie *z;
+  FILE *fp;
+  int bzerror;
+  if (zfile_suffix_kind(filename) == ZFILE_PLAIN)
+    return fopen(filename, (mode[0] == 'w') ? "w" : "r");
+  if (mode[0] != 'w') {
+    FILE *test = fopen(filename, "rb");   /* fail now, not on first read */
+    if (test == NULL)
+      return NULL;
+    fclose(test);
+  }
+  z = zfile_new(zfile_suffix_kind(filename), maxnfiles);
+  zfile_push(z, filename, &maxnfiles);
+  if (mode[0] == 'w') {
+    z->writing = 1;
+    if (z->kind == ZFILE_GZIP) {
+      z->gz = gzopen(filename, "wb");
+      if (z->gz == NULL)
+	goto fail;
+    }
+    else {
+      z->fp = fopen(filename, "wb");
+      if (z->fp == NULL)
+	goto fail;
+      z->bz = BZ2_bzWriteOpen(&bzerror, z->fp, 9, 0, 0);
+      if (bzerror != BZ_OK)
+	goto fail;
+    }
+  }
+  fp = zfile_fopen_cookie(z, (mode[0] == 'w') ? "w" : "r");
+  if (fp != NULL)
+    return fp;
+ fail:
+  zfile_close_current(z);
+  zfile_free(z);
+  return NULL;
+}  /* zfopen() */
+
+/*! zfile_command() returns a cookie that runs command in-process if it
+ *! just decompresses or concatenates files, and NULL otherwise.
+ */
+
+static inline zfile_cookie *zfile_command(const char *command) {
+  const char *cp = command;
+  enum zfile_kind kind;
+  size_t maxnfiles = 8, len, i;
+  zfile_cookie *z;
+  char *word;
+
+  if (strpbrk(command, "\"'\\$`;&|<>(){}~#!=") != NULL)
+    return NULL;                       /* needs a shell */
+  while (*cp == ' ' || *cp == '\t')
+    ++cp;
+  if (strncmp(cp, "cat ", 4) == 0)
+    kind = ZFILE_PLAIN, cp += 4;
+  else if (strncmp(cp, "zcat ", 5) == 0)
+    kind = ZFILE_GZIP, cp += 5;
+  else if (strncmp(cp, "gunzip -c ", 10) == 0)
+    kind = ZFILE_GZIP, cp += 10;
+  else if (strncmp(cp, "bzcat ", 6) == 0)
+    kind = ZFILE_BZIP2, cp += 6;
+  else
+    return NULL;
+
+  z = zfile_new(kind, maxnfiles);
+  word = (char *) malloc(strlen(cp) + 1);
+  for (;;) {
+    while (*cp == ' ' || *cp == '\t' || *cp == '\n')
+      ++cp;
+    if (*cp == '\0')
+      break;
+    len = strcspn(cp, " \t\n");
+    memcpy(word, cp, len);
+    word[len] = '\0';
+    cp += len;
+    if (word[0] == '-') {              /* an option we don't know */
+      zfile_free(z);
+      free(word);
+      return NULL;
+    }
+    if (strpbrk(word, "*?[") != NULL) {
+      glob_t g;
+      if (glob(word, 0, NULL, &g) == 0) {
+	for (i = 0; i < g.gl_pathc; ++i)
+	  zfile_push(z, g.gl_pathv[i], &maxnfiles);
+	globfree(&g);
+	continue;
+      }
+    }
+    zfile_push(z, word, &maxnfiles);
+  }
+  free(word);
+  return z;
+}  /* zfile_command() */
+
+/*! zpopen() returns a FILE* from which the output of command can be
+ *! read, or NULL if that fails.
+ */
+
+static inline FILE *zpopen(const char *command) {
+  size_t maxnfiles = 1, i;
+  zfile_cookie *z = zfile_command(command);
+  FILE *fp;
+
+  if (z != NULL) {
+    for (i = 0; i < z->nfiles; ++i) {  /* fail now, not on first read */
+      FILE *test = fopen(z->files[i], "rb");
+      if (test == NULL) {
+	fprintf(stderr, "## Error in zfile.h: can't open %s\n", z->files[i]);
+	zfile_free(z);
+	return NULL;
+      }
+      fclose(test);
+    }
+  }
+  else {
+    z = zfile_new(ZFILE_PIPE, maxnfiles);
+    zfile_push(z, command, &maxnfiles);
+    if (zfile_open_next(z) != 0) {     /* start the command now */
+      zfile_free(z);
+      return NULL;
+    }
+  }
+  fp = zfile_fopen_cookie(z, "r");
+  if (fp == NULL) {
+    zfile_close_current(z);
+    zfile_free(z);
+  }
+  return fp;
+}  /* zpopen() */
+
+#endif /* ZFILE_H */
@@ -16,38 +16,68 @@
 //
 //! An ipstream is an istream that reads from a popen command.
 //! A izstream is an istream that reads from a (possibly) compressed file
+//!
+//! Both read through the FILE*s returned by zpopen() and zfopen() in
+//! zfile.h, so gzip and bzip2 files are decompressed in-process rather
+//! than by a zcat or bzcat child process.
 
 #ifndef POPEN_H
 #define POPEN_H
 
 #include <cstdio>
 #include <cstring>
-#ifdef __clang__
-#include "fdstream.hpp"
-#else
-#include <ext/stdio_filebuf.h>
-#endif
 #include <iostream>
+#include <streambuf>
 #include <string>
 
+#include "zfile.h"
+
+//! stdio_inbuf{} is a streambuf that reads from a FILE*.  The FILE*s
+//! returned by zfopen() and zpopen() need not have a file descriptor,
+//! so neither __gnu_cxx::stdio_filebuf nor boost::fdinbuf (which both
+//! read from fileno()) can be used.
+//
+class stdio_inbuf : public std::streambuf {
+  FILE* fp;
+  static const int pbSize = 4;         //!< size of putback area
+  static const int bufSize = 65536;    //!< size of the data buffer
+  char buffer[bufSize+pbSize];
+
+public:
+  stdio_inbuf(FILE* fp) : fp(fp) { 
+    setg(buffer+pbSize, buffer+pbSize, buffer+pbSize);
+  }
+
+protected:
+  virtual int_type underflow() {
+    if (gptr() < egptr())
+      return traits_type::to_int_type(*gptr());
+    int numPutback = gptr() - eback();
+    if (numPutback > pbSize)
+      numPutback = pbSize;
+    memmove(buffer+(pbSize-numPutback), gptr()-numPutback, numPutback);
+    size_t num = (fp == NULL) ? 0 : fread(buffer+pbSize, 1, bufSize, fp);
+    if (num == 0)
+      return traits_type::eof();
+    setg(buffer+(pbSize-numPutback), buffer+pbSize, buffer+pbSize+num);
+    return traits_type::to_int_type(*gptr());
+  }
+};  // stdio_inbuf{}
+
 //! ipstream_helper{} exists so that the various file buffers get created before the istream
-//! gets created.
+//! gets created.  If the command or file can't be opened stdio_fp is NULL
+//! and the istream is bad.
 //
 struct ipstream_helper {
   FILE* stdio_fp;
-#ifdef __clang__
-  boost::fdinbuf stdio_fb;
+  stdio_inbuf stdio_fb;
 
-  ipstream_helper(const char* command)
-    : stdio_fp(popen(command, "r")), stdio_fb(fileno(stdio_fp)) { }
-#else
-  __gnu_cxx::stdio_filebuf<char> stdio_fb;
+  ipstream_helper(FILE* fp) : stdio_fp(fp), stdio_fb(fp) { }
 
   ipstream_helper(const char* command) 
-    : stdio_fp(popen(command, "r")), stdio_fb(stdio_fp, std::ios_base::in) { }
-#endif
+    : ipstream_helper(zpopen(command)) { }
 
-  ~ipstream_helper() { pclose(stdio_fp); }  // close the popen'd stream
+  ~ipstream_helper() { if (stdio_fp != NULL) fclose(stdio_fp); }  // close the zpopen'd stream
 }; // ipstream_helper{}
 
 
@@ -56,39 +86,28 @@ struct ipstream_helper {
 //
 struct ipstream : public ipstream_helper, public std::istream {
   ipstream(const char* command)       //!< shell command whose output is sent to the istream
-    : ipstream_helper(command), std::istream(&stdio_fb) { }
+    : ipstream_helper(command), std::istream(&stdio_fb) { 
+    if (stdio_fp == NULL)
+      setstate(std::ios_base::badbit);
+  }
 
   ipstream(const std::string& command) //!< shell command whose output is sent to the istream
-    : ipstream_helper(command.c_str()), std::istream(&stdio_fb) { }
+    : ipstream_helper(command.c_str()), std::istream(&stdio_fb) { 
+    if (stdio_fp == NULL)
+      setstate(std::ios_base::badbit);
+  }
 }; // ipstream{}
 
 
-//! izstream_helper{} exists to compute the command that ipstream has to execute
-//! while izstream is being constructed.
+//! An izstream reads a file, decompressing it with zlib or libbz2 if its
+//! name ends in .gz or .bz2 respectively.
 //
-struct izstream_helper {
-  std::string popen_command;
-
-  izstream_helper(const char* filename) 
-  {
-    const char* filesuffix = strrchr(filename, '.');
-
-    if (filesuffix == NULL)
-        filesuffix = "";
-
-    popen_command = (strcasecmp(filesuffix, ".bz2")
-		     ? (strcasecmp(filesuffix, ".gz") ? "cat " : "gunzip -c ")
-		     : "bzcat ");
-    popen_command += filename;
-  }
-};  // izstream_helper{}
-
-//! An izstream popen's a set of files, running them through zcat, bzcat or cat
-//! depending on the suffix of the last file.
-//
-struct izstream : public izstream_helper, public ipstream {
+struct izstream : public ipstream_helper, public std::istream {
   izstream(const char* filename) 
-    : izstream_helper(filename), ipstream(popen_command.c_str()) { }
+    : ipstream_helper(zfopen(filename, "r")), std::istream(&stdio_fb) { 
+    if (stdio_fp == NULL)
+      setstate(std::ios_base::badbit);
+  }
 }; // izstream{}
 
 #endif // POPEN_H
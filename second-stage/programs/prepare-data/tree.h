@@ -141,6 +141,7 @@
 #include "sym.h"
 #include "symset.h"
 #include "utility.h"
+#include "zfile.h"
 
 #include <algorithm>
 #include <cassert>
@@ -148,6 +149,7 @@
 #include <cstdio>
 #include <deque>
 #include <fstream>
+#include <glob.h>
 #include <iostream>
 #include <memory>
 #include <numeric>
@@ -1106,18 +1108,21 @@ void map_filenamefile_trees(const char* filenamefile, Proc& proc, bool downcase_
 }
 
 
+//! map_regex_trees() calls proc on each tree in each file matching the
+//! glob filename_regex, in the order ls would list them.  .gz and .bz2
+//! files are decompressed as they are read.
+//
 template <typename proc_type>
 void map_regex_trees(const char* filename_regex, proc_type& proc, bool downcase_flag = false)  
 {
-  std::string command("ls ");
-  command += filename_regex;
-  FILE* filenamefp = popen(command.c_str(), "r");
-  int nread;
-  char filename[1024];						 // NOTE max filename length
-  while((nread = fscanf(filenamefp, "%1024s", filename)) == 1) { // NOTE here too!
+  glob_t g;
+  if (glob(filename_regex, 0, NULL, &g) != 0)
+    return;
+  for (size_t i = 0; i < g.gl_pathc; ++i) {
+    const char* filename = g.gl_pathv[i];
     readtree_filename = filename;
     readtree_lineno = 1;
-    FILE* fp = fopen(filename, "r");
+    FILE* fp = zfopen(filename, "r");
     assert(fp);
 
     while (const tree* tp = readtree_root(fp, downcase_flag)) {
@@ -1127,7 +1132,7 @@ void map_regex_trees(const char* filename_regex, proc_type& proc, bool downcase_
 
     fclose(fp);
   }
-  pclose(filenamefp);
+  globfree(&g);
 }  // map_regex_trees()
 
 
@@ -38,7 +38,7 @@ const char usage[] =
 "avper version of 17th July, 2008\n"
 "\n"
 "Usage: avper [-N nruns] [-b burnin] [-c weightdecay] [-d debug] [-e evalfile] [-F fweight] [-g]\n"
-"             [-n nepochs] [-o outfile] [-r reduce] [-s randseed] [-f ignore] [-x ignore] < traindata\n"
+"             [-P] [-n nepochs] [-o outfile] [-r reduce] [-s randseed] [-f ignore] [-x ignore] < traindata\n"
 "\n"
 "where:\n"
 "\n"
@@ -50,6 +50,7 @@ const char usage[] =
 " -F          - weight each parse by its f-score,\n"
 " -g          - weight each sentence by size of its gold parse,\n"
 " -n nepochs  - the number of training epochs,\n"
+" -P          - pack each sentence's features (see pack_corpus() in lmdata.h),\n"
 " -o outfile  - file to which trained feature weights are written,\n"
 " -r reduce   - factor at which the learning rate is decreased each epoch,\n"
 " -s randseed - seed for random number generator.\n"
@@ -76,6 +77,8 @@ void avper(corpus_type *traindata, Float b, Float n, Float r, Float weightdecay,
   assert(sum_w != NULL);
   size_type *changed = (size_type *) calloc(nfeatures, sizeof(size_type));
   assert(changed != NULL);
+  Float *lw = (Float *) malloc((traindata->maxnlf+1)*sizeof(Float));
+  assert(lw != NULL);
 
   size_type index;
   double rfactor = double(traindata->nsentences)/(RAND_MAX+1.0);
@@ -91,7 +94,7 @@ void avper(corpus_type *traindata, Float b, Float n, Float r, Float weightdecay,
       index = size_type(rfactor*random());
       assert(index < traindata->nsentences);
       if (traindata->sentence[index].Px > 0)
-	ap_sentence(&traindata->sentence[index], w, dw, weightdecay, sum_w, it, changed);
+	ap_sentence(&traindata->sentence[index], w, dw, weightdecay, sum_w, it, changed, lw);
       dw *= ddw;
     }
 
@@ -113,7 +116,7 @@ void avper(corpus_type *traindata, Float b, Float n, Float r, Float weightdecay,
     assert(index < traindata->nsentences);
     dw *= ddw;
     if (traindata->sentence[index].Px > 0)
-      ap_sentence(&traindata->sentence[index], w, dw, weightdecay, sum_w, it, changed);
+      ap_sentence(&traindata->sentence[index], w, dw, weightdecay, sum_w, it, changed, lw);
   }
 
   if (debug_level >= 1000)
@@ -129,6 +132,7 @@ void avper(corpus_type *traindata, Float b, Float n, Float r, Float weightdecay,
 
   free(sum_w);
   free(changed);
+  free(lw);
 }  // avper()
  
 void print_histogram(int nx, double x[], int nbins=20) {
@@ -166,13 +170,14 @@ int main(int argc, char **argv)
   char *evalfile = NULL, *outfile = NULL;
   Float Pyx_f = 0;
   bool Px_g = 0;
+  bool packed = false;
   size_t randseed = 0;
   size_type nruns = 1;
 
   opterr = 0;
   
   char c, *cp;
-  while ((c = getopt(argc, argv, "F:N:f:gb:c:d:n:o:r:e:s:x:")) != -1)
+  while ((c = getopt(argc, argv, "F:N:f:gb:c:d:n:o:Pr:e:s:x:")) != -1)
     switch (c) {
     case 'N':
       nruns = strtol(optarg, &cp, 10);
@@ -215,6 +220,9 @@ int main(int argc, char **argv)
     case 'o':
       outfile = optarg;
       break;
+    case 'P':
+      packed = true;
+      break;
     case 'r':
       reduce = strtod(optarg, &cp);
       if (cp == NULL || *cp != '\0')
@@ -241,6 +249,7 @@ int main(int argc, char **argv)
 	      << ", debug_level = " << debug_level 
 	      << ", Pyx_f = " << Pyx_f
 	      << ", Px_g = " << Px_g
+	      << ", packed = " << packed
 	      << ", nepochs = " << nepochs 
 	      << ", reduce = " << reduce 
 	      << ", randseed = " << randseed
@@ -249,46 +258,14 @@ int main(int argc, char **argv)
 
   srandom(randseed+1);
 
-  corpusflags_type corpusflags = { Pyx_f, Px_g };
+  corpusflags_type corpusflags = { Pyx_f, Px_g, packed };
 
   corpus_type* traindata = read_corpus(&corpusflags, stdin);
   int nx = traindata->nfeatures;
 
   corpus_type* evaldata = traindata;
   if (evalfile != NULL) {
-    const char* filesuffix = strrchr(evalfile, '.');
-    bool popen_flag = false;
-    FILE *in;
-    if (strcasecmp(filesuffix, ".bz2") == 0) {
-      std::string command("bzcat ");
-      command += evalfile;
-      in = popen(command.c_str(), "r");
-      popen_flag = true;
-    }
-    else if (strcasecmp(filesuffix, ".gz") == 0) {
-      std::string command("gunzip -c ");
-      command += evalfile;
-      errno = 0;
-      in = popen(command.c_str(), "r");
-      if (in == NULL) {
-	perror("## Error in cvlm: ");
-	std::cerr << "## popen(" << command << "\"r\")" << std::endl;
-      }
-      popen_flag = true;
-    }
-    else
-      in = fopen(evalfile, "r");
-    if (in == NULL) {
-      std::cerr << "## Couldn't open evalfile " << evalfile
-		<< ", errno = " << errno << "\n" 
-		<< usage << std::endl;
-      exit(EXIT_FAILURE);
-    }
-    evaldata = read_corpus(&corpusflags, in);
-    if (popen_flag)
-      pclose(in);
-    else
-      fclose(in);
+    evaldata = read_corpus_file(&corpusflags, evalfile);
     int nxe = evaldata->nfeatures;
     assert(nxe <= nx);
   }
@@ -0,0 +1,53 @@
+// Licensed under the Apache License, Version 2.0 (the "License"); you may
+// not use this file except in compliance with the License.  You may obtain
+// a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations
+// under the License.
+
+// compile-corpus.cc
+//
+// compile-corpus reads a feature-count corpus (as written by
+// extract-spfeatures) and writes it in the binary format that
+// read_corpus() maps into memory, so that cvlm-lbfgs, avper, gavper
+// and oracle can load it without parsing it again.
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+
+#include "lmdata.h"
+
+int main(int argc, char* argv[])
+{
+  if (argc != 3) {
+    std::cerr << "Usage: " << argv[0] << " corpus(.gz|.bz2) binary-corpus\n"
+	      << "\n"
+	      << " converts the text corpus into a binary corpus file, which all\n"
+	      << " programs that read corpora accept in its place.\n"
+	      << " The binary file uses this machine's byte order." << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  corpusflags_type cflags = { 0.0, 0 };
+  corpus_type* corpus = read_corpus_file(&cflags, argv[1]);
+
+  FILE* out = fopen(argv[2], "wb");
+  if (out == NULL) {
+    std::cerr << "## Error: couldn't open " << argv[2] << " for writing" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  write_corpus_binary(corpus, out);
+  if (fclose(out) != 0) {
+    std::cerr << "## Error: couldn't write " << argv[2] << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  std::cerr << "# compile-corpus: " << corpus->nsentences << " sentences, " 
+	    << corpus->nfeatures << " features written to " << argv[2] << std::endl;
+} // main()
@@ -21,9 +21,9 @@ const char usage[] =
 " The regularizer weight(s) are set by cross-validation on development data.\n"
 "\n"
 "Usage: cvlm-lbfgs [-h] [-d debug_level] [-c c0] [-C c00] [-p p] [-r r] [-s s] [-t tol]\n"
-"                  [-l ltype] [-F f] [-G] [-n ns] [-f feat-file]\n"
+"                  [-l ltype] [-F f] [-G] [-P] [-n ns] [-f feat-file]\n"
 "                  [-o weights-file]  [-e eval-file] [-x eval-file2]\n"
-"                  [-i iterations]\n"
+"                  [-i iterations] [-j jobs]\n"
 "	           < train-file\n"
 "\n"
 "where:\n"
@@ -38,6 +38,13 @@ const char usage[] =
 " -i iterations specifies the maximum number of regularization constants to search\n"
 " (defaults to 10 if not binning feature classes and 50 otherwise)\n"
 "\n"
+" -j jobs trains up to jobs regularizer settings at once.  With jobs > 1,\n"
+" the regularizer constants are tuned by a parallel pattern search instead\n"
+" of COBYLA: each round trains the settings one step up and down from the\n"
+" best setting so far along each regularizer class, and halves the step\n"
+" when none of them is better.  Each setting's training starts from the\n"
+" weights of the nearest setting already trained.\n"
+"\n"
 " -l ltype identifies the type of loss function used:\n"
 "\n"
 "    -l 0 - log loss (c0 ~ 5)\n"
@@ -58,6 +65,9 @@ const char usage[] =
 " -G indicates that each sentence is weighted by the number of\n"
 "   edges in its gold parse.\n"
 "\n"
+" -P packs each sentence's features (see pack_corpus() in lmdata.h),\n"
+"   which speeds up the loss function evaluations.\n"
+"\n"
 " -n ns is the maximum number of ':' characters in a <featclass>, used to\n"
 " determine how features are binned into feature classes (ns = -1 bins\n"
 " all features into the same class)\n"
@@ -66,8 +76,8 @@ const char usage[] =
 " cross-validating regularizer weights,\n"
 "\n"
 " train-file, eval-file and eval-file2 are files from which training and evaluation\n"
-" data are read (if eval-file ends in the suffix .bz2 then bzcat is used\n"
-" to read it; if no eval-file is specified, then the program tests on the\n"
+" data are read (.bz2 and .gz files are decompressed as they are read;\n"
+" if no eval-file is specified, then the program tests on the\n"
 " training data),\n"
 "\n"
 " weights-file is a file to which the estimated weights are written,\n"
@@ -123,9 +133,14 @@ const char usage[] =
 #include <unistd.h>
 #include <vector>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 #include <lbfgs.h>
 
 #include "lmdata.h"
+#include "zfile.h"
 #include "cobyla.h"
 #include "utility.h"
 
@@ -309,6 +324,7 @@ struct Estimator1 {
   double c0;		//!< default regularizer factor
   double c00;           //!< multiply default regularizer factor for first feature class
   int cobyla_iterations; //!< maximum number of COBYLA iterations
+  int jobs;             //!< number of regularizer settings trained at once
   double p;		//!< regularizer power
   double r;		//!< random initialization
   double s;		//!< scale factor
@@ -333,10 +349,10 @@ struct Estimator1 {
 
   Estimator1(loss_type ltype, double c0, double c00, int cobyla_iterations,
           double p, double r, double s, double tol=1e-5,
-          bool opt_fscore = true, std::string weightsfile = "")
+          bool opt_fscore = true, std::string weightsfile = "", int jobs = 1)
     : train(NULL), nx(0), eval(NULL), eval2(NULL),
       ltype(ltype), c0(c0), c00(c00), cobyla_iterations(cobyla_iterations),
-      p(p), r(r), s(s), tol(tol), opt_fscore(opt_fscore), lcs(1, log(c0)),
+      jobs(jobs), p(p), r(r), s(s), tol(tol), opt_fscore(opt_fscore), lcs(1, log(c0)),
       nc(1), nits(0), sum_nits(0), nrounds(0), best_score(0),
       weightsfile(weightsfile)
   { } // Estimator1::Estimator1()
@@ -354,40 +370,30 @@ struct Estimator1 {
     assert(eval2 == NULL || eval2->nfeatures <= train->nfeatures);
   } // Estimator1::set_data()
 
-  // operator() actually runs one round of estimation
+  //! initial_weights() sets x0 to the starting weights for a round
+  //! that does not start from another round's weights
   //
-  double operator() (const doubles& lccs) {
+  void initial_weights(doubles& x0) const {
+    x0.resize(nx);
+    for (size_type i = 0; i < nx; ++i) 
+      x0[i] = (r != 0) ? r*double(random()-RAND_MAX/2)/double(RAND_MAX/2) : 0;
+  }  // Estimator1::initial_weights()
+
+  //! optimize() runs L-BFGS from the weights x0 with regularizer log
+  //! factors lccs, leaving the estimated weights in x0.  It only reads
+  //! the Estimator1, so several calls may run at once.
+  //
+  void optimize(const doubles& lccs, doubles& x0, 
+		size_type& nits, double& L, double& R, double& Q) const {
     assert(lccs.size() == nc);
+    assert(x0.size() == nx);
     doubles ccs(nc);
-    double L, R, Q;
 
     for (size_type i = 0; i < nc; ++i)
       ccs[i] = exp(lccs[i]);
 
-    assert(x.size() == nx);
-    nits = 0;
-    nrounds++;
-
-    if (debug_level >= 10) {
-      if (nrounds == 1) 
-	std::cerr << "# round	nfeval	L	R	Q	neglogP	f-score	css" << std::endl;
-      std::cerr << nrounds << std::flush;
-    }
- 
     LossFn fn(ltype, train, f_c, ccs, p, s);
 
-    double *x0 = new double[nx];
-
-    if (r != 0) {
-        for (size_type i = 0; i < nx; ++i) {
-            x0[i] = r*double(random()-RAND_MAX/2)/double(RAND_MAX/2);
-        }
-    } else {
-        for (size_type i = 0; i < nx; ++i) {
-            x0[i] = 0;
-        }
-    }
-    
     lbfgs_parameter_t params;
     lbfgs_parameter_init(&params);
     params.epsilon = tol; // determines termination based on Q values
@@ -400,35 +406,59 @@ struct Estimator1 {
         params.linesearch = LBFGS_LINESEARCH_BACKTRACKING;
     }
 
-    int ret = lbfgs(nx, x0, NULL, loss_function_objective_wrapper,
+    int ret = lbfgs(nx, &x0[0], NULL, loss_function_objective_wrapper,
         NULL, &fn, &params);
     if (ret != 0) {
         std::cerr << " [lbfgs returned: " << ret << "]";
     }
-    for (size_type i = 0; i < nx; ++i) {
-        x[i] = x0[i];
-    }
 
     nits = fn.it;
     L = fn.L;
     R = fn.R;
     Q = fn.Q;
+  }  // Estimator1::optimize()
+
+  //! finish_round() makes x0, estimated with regularizer log factors
+  //! lccs, the current weights, and evaluates them
+  //
+  double finish_round(const doubles& lccs, const doubles& x0,
+		      size_type round_nits, double L, double R, double Q) {
+    nits = round_nits;
+    nrounds++;
+    x = x0;
 
     // Clean up, collect stats
 
     sum_nits += nits;
 
-    if (debug_level >= 10)
-      std::cerr << '\t' << nits << '\t' << L << '\t' << R << '\t' << Q;
+    if (debug_level >= 10) {
+      if (nrounds == 1) 
+	std::cerr << "# round	nfeval	L	R	Q	neglogP	f-score	css" << std::endl;
+      std::cerr << nrounds << '\t' << nits << '\t' << L << '\t' << R << '\t' << Q;
+    }
 
     double score = evaluate(opt_fscore, true);
 
-    if (debug_level >= 10)
+    if (debug_level >= 10) {
+      doubles ccs(nc);
+      for (size_type i = 0; i < nc; ++i)
+	ccs[i] = exp(lccs[i]);
       std::cerr << '\t' << ccs << std::endl;
+    }
 
-    delete x0;
     return score;
+  }  // Estimator1::finish_round()
 
+  // operator() actually runs one round of estimation
+  //
+  double operator() (const doubles& lccs) {
+    doubles x0;
+    size_type round_nits;
+    double L, R, Q;
+
+    initial_weights(x0);
+    optimize(lccs, x0, round_nits, L, R, Q);
+    return finish_round(lccs, x0, round_nits, L, R, Q);
   }  // Estimator1::operator()
 
   // evaluate() evaluates the current model on the eval data, prints
@@ -554,32 +584,8 @@ struct Estimator1 {
 			   int nseparators = 1,
 			   const char* separators = ":") {
     
-    const char* filesuffix = strrchr(filename, '.');
-    bool popen_flag = false;
-    FILE *in;
-    if (strcasecmp(filesuffix, ".bz2") == 0) {
-      std::string command("bzcat ");
-      command += filename;
-      in = popen(command.c_str(), "r");
-      if (in == NULL) {
-	perror("## Error in cvlm-lbfgs: ");
-	std::cerr << "## popen(\"" << command << "\", \"r\") failed, usage = " << resource_usage() << std::endl;
-      }
-      popen_flag = true;
-    }
-    else if (strcasecmp(filesuffix, ".gz") == 0) {
-      std::string command("gunzip -c ");
-      command += filename;
-      errno = 0;
-      in = popen(command.c_str(), "r");
-      if (in == NULL) {
-	perror("## Error in cvlm-lbfgs: ");
-	std::cerr << "## popen(\"" << command << "\", \"r\") failed, usage = " << resource_usage() << std::endl;
-      }
-      popen_flag = true;
-    }
-    else
-      in = fopen(filename, "r");
+    errno = 0;
+    FILE *in = zfopen(filename, "r");
     if (in == NULL) {
       std::cerr << "## Couldn't open evalfile " << filename
 		<< ", errno = " << errno << "\n" 
@@ -638,14 +644,128 @@ struct Estimator1 {
     if (debug_level >= 0) 
       std::cerr << "# Regularization classes: " << regclass_identifiers << std::endl;
 
-    if (popen_flag)
-      pclose(in);
-    else
-      fclose(in);
+    fclose(in);
   }  // Estimator1::read_featureclasses()
     
+  //! A Trained object holds the weights estimated with the regularizer
+  //! log factors lcs
+  //
+  struct Trained {
+    doubles lcs;
+    doubles x;
+    size_type nits;
+    double L, R, Q, score;
+  };  // Estimator1::Trained{}
+  typedef std::vector<Trained> Traineds;
+
+  //! nearest() returns the element of ts whose lcs is closest to lcs,
+  //! or NULL if ts is empty
+  //
+  static const Trained* nearest(const Traineds& ts, const doubles& lcs) {
+    const Trained* best = NULL;
+    double best_d2 = 0;
+    cforeach (Traineds, it, ts) {
+      double d2 = 0;
+      for (size_type i = 0; i < lcs.size(); ++i)
+	d2 += (it->lcs[i] - lcs[i]) * (it->lcs[i] - lcs[i]);
+      if (best == NULL || d2 < best_d2) {
+	best = &*it;
+	best_d2 = d2;
+      }
+    }
+    return best;
+  }  // Estimator1::nearest()
+
+  //! estimate_parallel() tunes lcs by a pattern search, training up to
+  //! jobs settings concurrently on the shared training corpus.  Unless
+  //! nested parallelism is enabled, each job's corpus_stats() calls run
+  //! in the job's own thread.  The settings of a round are evaluated on
+  //! the dev data in order once they are all trained, so the output and
+  //! the weights file do not depend on which job finishes first.
+  //
+  void estimate_parallel()
+  {
+    const double min_step = 1e-3;	// as COBYLA's rhoend
+    double step = log(2);		// as COBYLA's rhobeg
+    int max_evaluations = cobyla_iterations;
+    if (max_evaluations == -1)
+      max_evaluations = nc > 1 ? 10 : 50;
+
+    Trained best;
+    Traineds trained;     // settings whose weights can seed the next round
+    Traineds round(1);
+    round[0].lcs = lcs;
+    int nevaluations = 0;
+    size_type nprobes = std::max(1, jobs / int(2*nc));  // probes per direction
+
+    while (!round.empty()) {
+      for (size_type k = 0; k < round.size(); ++k) {
+	const Trained* seed = nearest(trained, round[k].lcs);
+	if (seed != NULL)
+	  round[k].x = seed->x;
+	else
+	  initial_weights(round[k].x);
+      }
+
+      int nthreads = std::min(jobs, int(round.size()));
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads) if (nthreads > 1)
+#endif
+      for (int k = 0; k < int(round.size()); ++k)
+	optimize(round[k].lcs, round[k].x, round[k].nits, 
+		 round[k].L, round[k].R, round[k].Q);
+
+      bool improved = false;
+      for (size_type k = 0; k < round.size(); ++k) {
+	Trained& t = round[k];
+	t.score = finish_round(t.lcs, t.x, t.nits, t.L, t.R, t.Q);
+	if (nevaluations++ == 0 || t.score < best.score) {
+	  best = t;
+	  improved = true;
+	}
+      }
+
+      if (!improved)
+	step /= 2;
+      if (step < min_step)
+	break;
+
+      trained.swap(round);
+      trained.push_back(best);
+      round.clear();
+      for (size_type n = 1; n <= nprobes; ++n)
+	for (size_type i = 0; i < nc; ++i)
+	  for (int sign = -1; sign <= 1; sign += 2) {
+	    if (nevaluations + int(round.size()) >= max_evaluations)
+	      continue;
+	    Trained t;
+	    t.lcs = best.lcs;
+	    t.lcs[i] += sign * double(n) * step;
+	    round.push_back(t);
+	  }
+    }
+
+    lcs = best.lcs;
+    x = best.x;
+
+    if (debug_level > 0) {
+      std::cerr << "# Regularizer class weights = (";
+      for (size_type i = 0; i < lcs.size(); ++i) {
+	if (i > 0)
+	  std::cerr << ' ';
+	std::cerr << exp(lcs[i]);
+      }
+      std::cerr << ')' << std::endl;
+    }
+  }  // Estimator1::estimate_parallel()
+
   void estimate()
   {
+    if (jobs > 1) {
+      estimate_parallel();
+      return;
+    }
+
     // convert vector to double for COBYLA
     int num_lcs = lcs.size();
     double *lcs_array = new double[num_lcs];
@@ -715,16 +835,18 @@ int main(int argc, char** argv)
   double c0 = 2.0;
   double c00 = 1.0;
   int cobyla_iterations = -1;
+  int jobs = 1;
   double p = 2.0;
   double r = 0.0;
   double s = 1.0;
   double tol = 5e-1;
   double Pyx_factor = 0.0;
   bool Px_propto_g = false;
+  bool packed = false;
   int nseparators = 1;
   std::string  feat_file, weights_file, eval_file, eval2_file;
   int opt;
-  while ((opt = getopt(argc, argv, "hd:c:C:i:p:r:s:t:l:F:Gn:f:o:e:x:")) != -1) 
+  while ((opt = getopt(argc, argv, "hd:c:C:i:j:p:r:s:t:l:F:GPn:f:o:e:x:")) != -1) 
     switch (opt) {
     case 'h':
       std::cerr << usage << exit_failure;
@@ -741,6 +863,9 @@ int main(int argc, char** argv)
     case 'i':
       cobyla_iterations = atoi(optarg);
       break;
+    case 'j':
+      jobs = atoi(optarg);
+      break;
     case 'p':
       p = atof(optarg);
       break;
@@ -762,6 +887,9 @@ int main(int argc, char** argv)
     case 'G':
       Px_propto_g = true;
       break;
+    case 'P':
+      packed = true;
+      break;
     case 'n':
       nseparators = atoi(optarg);
       break;
@@ -784,12 +912,14 @@ int main(int argc, char** argv)
 	      << ", regularization -c = " << c0
 	      << ", c00 -C = " << c00
 	      << ", COBYLA iterations -i = " << cobyla_iterations
+	      << ", jobs -j = " << jobs
 	      << ", power -p = " << p 
 	      << ", scale -s = " << s
 	      << ", tol -t = " << tol
 	      << ", random init -r = " << r 
 	      << ", Pyx_factor -F = " << Pyx_factor
 	      << ", Px_propto_g -G = " << Px_propto_g
+	      << ", packed -P = " << packed
 	      << ", nseparators -n = " << nseparators
 	      << ", feat_file -f = " << feat_file
 	      << ", weights_file -o = " << weights_file
@@ -814,14 +944,14 @@ int main(int argc, char** argv)
       fclose(out);
   }
 
-  Estimator1 e(ltype, c0, c00, cobyla_iterations, p, r, s, tol, true, weights_file);
+  Estimator1 e(ltype, c0, c00, cobyla_iterations, p, r, s, tol, true, weights_file, jobs);
 
   if (!feat_file.empty())
     e.read_featureclasses(feat_file.c_str(), nseparators, ":");  
 
   // Read in eval data first, as that way we may squeeze everything into 4GB
     
-  corpusflags_type corpusflags = { Pyx_factor, Px_propto_g };
+  corpusflags_type corpusflags = { Pyx_factor, Px_propto_g, packed };
 
   corpus_type* evaldata = NULL;
   if (!eval_file.empty()) {
@@ -79,8 +79,8 @@ const char usage[] =
 " constant for the first feature class is multiplied by c00\n"
 "\n"
 " train-file, eval-file and eval-file2 are files from which training and evaluation\n"
-" data are read (if eval-file ends in the suffix .bz2 then bzcat is used\n"
-" to read it; if no eval-file is specified, then the program tests on the\n"
+" data are read (.bz2 and .gz files are decompressed as they are read;\n"
+" if no eval-file is specified, then the program tests on the\n"
 " training data),\n"
 "\n"
 " weights-file is a file to which the estimated weights are written,\n"
@@ -172,6 +172,7 @@ const char usage[] =
 #include <vector>
 
 #include "lmdata.h"
+#include "zfile.h"
 #include "powell.h"
 #include "utility.h"
 #include "tao-optimizer.h"
@@ -663,32 +664,8 @@ struct Estimator1 {
 			   int nseparators = 1,
 			   const char* separators = ":") {
     
-    const char* filesuffix = strrchr(filename, '.');
-    bool popen_flag = false;
-    FILE *in;
-    if (strcasecmp(filesuffix, ".bz2") == 0) {
-      std::string command("bzcat ");
-      command += filename;
-      in = popen(command.c_str(), "r");
-      if (in == NULL) {
-	perror("## Error in lm-owlqn: ");
-	std::cerr << "## popen(\"" << command << "\", \"r\") failed, usage = " << resource_usage() << std::endl;
-      }
-      popen_flag = true;
-    }
-    else if (strcasecmp(filesuffix, ".gz") == 0) {
-      std::string command("gunzip -c ");
-      command += filename;
-      errno = 0;
-      in = popen(command.c_str(), "r");
-      if (in == NULL) {
-	perror("## Error in lm-owlqn: ");
-	std::cerr << "## popen(\"" << command << "\", \"r\") failed, usage = " << resource_usage() << std::endl;
-      }
-      popen_flag = true;
-    }
-    else
-      in = fopen(filename, "r");
+    errno = 0;
+    FILE *in = zfopen(filename, "r");
     if (in == NULL) {
       std::cerr << "## Couldn't open evalfile " << filename
 		<< ", errno = " << errno << "\n" 
@@ -747,10 +724,7 @@ struct Estimator1 {
     if (debug_level >= 0) 
       std::cerr << "# Regularization classes: " << regclass_identifiers << std::endl;
 
-    if (popen_flag)
-      pclose(in);
-    else
-      fclose(in);
+    fclose(in);
   }  // Estimator1::read_featureclasses() 
     
   void estimate()
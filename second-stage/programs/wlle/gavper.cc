@@ -30,6 +30,7 @@
 #include "utility.h"
 #include "greedy.h"
 #include "lmdata.h"
+#include "zfile.h"
 
 const char usage[] =
 "gavper version of 1st August 2008\n"
@@ -37,7 +38,7 @@ const char usage[] =
 "Averaged perceptron with greedy feature class selector.\n"
 "\n"
 "Usage: gavper [-a] [-b burnin] [-d debug] [-F] [-g] [-m nseps] [-n nepochs]\n"
-"    [-o outfile] [-c c0] [-f feat.gz] [-e evalfile] [-x evalfile2]\n"
+"    [-o outfile] [-P] [-c c0] [-f feat.gz] [-e evalfile] [-x evalfile2]\n"
 "    [-r reduce] [-s randseed] < traindata\n"
 "\n"
 "where:\n"
@@ -53,6 +54,7 @@ const char usage[] =
 " -m nseps    - number of separators ':' in feature classes to keep,\n"
 " -n nepochs  - the number of training epochs,\n"
 " -o outfile  - file to which trained feature weights are written,\n"
+" -P          - pack each sentence's features (see pack_corpus() in lmdata.h),\n"
 " -r reduce   - factor at which the learning rate is decreased each epoch,\n"
 " -s randseed - random number seed, and\n"
 " -x evalfile2 - 2nd evaluation file\n";
@@ -209,6 +211,8 @@ struct Estimator1 {
     assert(sum_w != NULL);
     size_type *changed = (size_type *) calloc(nfeatures, sizeof(size_type));
     assert(changed != NULL);
+    Float *lw = (Float *) malloc((train->maxnlf+1)*sizeof(Float));
+    assert(lw != NULL);
     
     size_type index;
     double rfactor = double(train->nsentences)/(RAND_MAX+1.0);
@@ -221,7 +225,7 @@ struct Estimator1 {
 	assert(index < train->nsentences);
 	if (train->sentence[index].Px > 0)
 	  wap_sentence(&train->sentence[index], w, dw, feat_class, class_factor,
-		       sum_w, it, changed);
+		       sum_w, it, changed, lw);
 	dw *= ddw;
       }
 
@@ -244,7 +248,7 @@ struct Estimator1 {
       dw *= ddw;
       if (train->sentence[index].Px > 0)
 	wap_sentence(&train->sentence[index], w, dw, feat_class, class_factor, 
-		     sum_w, it, changed);
+		     sum_w, it, changed, lw);
     }
     
     if (debug_level >= 1000)
@@ -260,6 +264,7 @@ struct Estimator1 {
     
     free(sum_w);
     free(changed);
+    free(lw);
   }  // Evaluate1::avper()
 
   // evaluate() evaluates the current model on the eval data, prints
@@ -334,32 +339,8 @@ struct Estimator1 {
 			   int nseparators = 1,
 			   const char* separators = ":") {
     
-    const char* filesuffix = strrchr(filename, '.');
-    bool popen_flag = false;
-    FILE *in;
-    if (strcasecmp(filesuffix, ".bz2") == 0) {
-      std::string command("bzcat ");
-      command += filename;
-      in = popen(command.c_str(), "r");
-      if (in == NULL) {
-	perror("## Error in gavper: ");
-	std::cerr << "## popen(\"" << command << "\", \"r\") failed, usage = " << resource_usage() << std::endl;
-      }
-      popen_flag = true;
-    }
-    else if (strcasecmp(filesuffix, ".gz") == 0) {
-      std::string command("gunzip -c ");
-      command += filename;
-      errno = 0;
-      in = popen(command.c_str(), "r");
-      if (in == NULL) {
-	perror("## Error in gavper: ");
-	std::cerr << "## popen(\"" << command << "\", \"r\") failed, usage = " << resource_usage() << std::endl;
-      }
-      popen_flag = true;
-    }
-    else
-      in = fopen(filename, "r");
+    errno = 0;
+    FILE *in = zfopen(filename, "r");
     if (in == NULL) {
       std::cerr << "## Couldn't open evalfile " << filename
 		<< ", errno = " << errno << "\n" 
@@ -431,10 +412,7 @@ struct Estimator1 {
     if (debug_level >= 0) 
       std::cout << "# Regularization classes: " << regclass_identifiers << std::endl;
 
-    if (popen_flag)
-      pclose(in);
-    else
-      fclose(in);
+    fclose(in);
   }  // Estimator1::read_featureclasses()
     
   void estimate()
@@ -461,6 +439,7 @@ int main(int argc, char **argv)
   char *evalfile = NULL, *evalfile2 = NULL, *featfile = NULL, *outfile = NULL;
   Float Pyx_f = 0;
   bool Px_g = 0;
+  bool packed = false;
   size_t randseed = 0;
 
   opterr = 0;
@@ -468,7 +447,7 @@ int main(int argc, char **argv)
   int c;
   char *cp;
 
-  while ((c = getopt(argc, argv, "ab:c:d:e:F:gf:m:n:o:r:s:x:")) != -1)
+  while ((c = getopt(argc, argv, "ab:c:d:e:F:gf:m:n:o:Pr:s:x:")) != -1)
     switch (c) {
     case 'a':
       addfeats = true;
@@ -513,6 +492,9 @@ int main(int argc, char **argv)
     case 'o':
       outfile = optarg;
       break;
+    case 'P':
+      packed = true;
+      break;
     case 'r':
       reduce = strtod(optarg, &cp);
       if (cp == NULL || *cp != '\0')
@@ -541,6 +523,7 @@ int main(int argc, char **argv)
 	      << ", debug_level = " << debug_level 
 	      << ", Pyx_f = " << Pyx_f
 	      << ", Px_g = " << Px_g
+	      << ", packed = " << packed
 	      << ", nseparators = " << nseparators
 	      << ", nepochs = " << nepochs 
 	      << ", reduce = " << reduce 
@@ -548,7 +531,7 @@ int main(int argc, char **argv)
 	      << ", featfile = " << featfile
 	      << std::endl;
 
-  corpusflags_type corpusflags = { Pyx_f, Px_g };
+  corpusflags_type corpusflags = { Pyx_f, Px_g, packed };
 
   corpus_type* traindata = read_corpus(&corpusflags, stdin);
   int nx = traindata->nfeatures;
@@ -58,8 +58,8 @@ const char usage[] =
 " -debug debug_level > 0 controls the amount of output produced\n"
 "\n"
 " train-file and eval-file are files from which training and evaluation\n"
-" data are read (if eval-file ends in the suffix .bz2 then bzcat is used\n"
-" to read it; if no eval-file is specified, then the program tests on the\n"
+" data are read (.bz2 and .gz files are decompressed as they are read;\n"
+" if no eval-file is specified, then the program tests on the\n"
 " training data),\n"
 "\n"
 " weights-file is a file to which the estimated weights are written,\n"
@@ -465,34 +465,7 @@ int main(int argc, char** argv)
   corpus_type* evaldata = traindata;
   const char* evalfile = tao_env.get_cstr_option("-e");
   if (evalfile) {
-    const char* filesuffix = strrchr(evalfile, '.');
-    bool popen_flag = false;
-    FILE *in;
-    if (strcasecmp(filesuffix, ".bz2") == 0) {
-      std::string command("bzcat ");
-      command += evalfile;
-      in = popen(command.c_str(), "r");
-      popen_flag = true;
-    }
-    else if (strcasecmp(filesuffix, ".gz") == 0) {
-      std::string command("gunzip -c ");
-      command += evalfile;
-      in = popen(command.c_str(), "r");
-      popen_flag = true;
-    }
-    else
-      in = fopen(evalfile, "r");
-    if (in == NULL) {
-      std::cerr << "## Couldn't open evalfile " << evalfile
-		<< ", errno = " << errno << "\n" 
-		<< usage << std::endl;
-      exit(EXIT_FAILURE);
-    }
-    evaldata = read_corpus(&corpusflags, in);
-    if (popen_flag)
-      pclose(in);
-    else
-      fclose(in);
+    evaldata = read_corpus_file(&corpusflags, evalfile);
     int nxe = evaldata->nfeatures;
     assert(nxe <= nx);
   }
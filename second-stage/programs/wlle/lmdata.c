@@ -19,13 +19,21 @@
  * This is a version of data.c with additions for pairwise loss functions.
  */
 
+#include "zfile.h"    /* must be first, it defines _GNU_SOURCE */
 #include "lmdata.h"
 
 #include <assert.h>
 #include <math.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #define CALLOC(n, s)	calloc(n, s)
 #define MALLOC(n)	malloc(n)
@@ -69,6 +77,50 @@ Float parse_score(const parse_type *p, const Float w[]) {
   return score;
 }  /* parse_score() */
 
+/*! SENTENCE_FEATURE() is the feature that feature f of one of the
+ *! parses of s stands for; see pack_corpus().
+ */
+
+#define SENTENCE_FEATURE(s, f)  ((s)->lf != NULL ? (s)->lf[f] : (f))
+
+/*! sentence_weights() returns the weights with which the parses of s
+ *! are scored: w[] itself, or if s is packed, lw[] loaded with the
+ *! weights of s's features.  lw[] must have room for s->nlf weights.
+ */
+
+__inline__ static
+const Float *sentence_weights(const sentence_type *s, const Float w[], Float lw[]) {
+  size_type k;
+  if (s->lf == NULL)
+    return w;
+  for (k = 0; k < s->nlf; ++k)   /* one gather per sentence, not per parse */
+    lw[k] = w[s->lf[k]];
+  return lw;
+}  /* sentence_weights() */
+
+/*! sentence_gradient() returns the array in which the derivatives of
+ *! s are accumulated: dL_dw[] itself, or if s is packed, ldL_dw[]
+ *! zeroed.  add_sentence_gradient() then adds them to dL_dw[].
+ */
+
+__inline__ static
+Float *sentence_gradient(const sentence_type *s, Float dL_dw[], Float ldL_dw[]) {
+  size_type k;
+  if (s->lf == NULL)
+    return dL_dw;
+  for (k = 0; k < s->nlf; ++k)
+    ldL_dw[k] = 0;
+  return ldL_dw;
+}  /* sentence_gradient() */
+
+__inline__ static
+void add_sentence_gradient(const sentence_type *s, const Float ldL_dw[], Float dL_dw[]) {
+  size_type k;
+  if (s->lf != NULL)
+    for (k = 0; k < s->nlf; ++k)
+      dL_dw[s->lf[k]] += ldL_dw[k];
+}  /* add_sentence_gradient() */
+
 /*! sentence_scores() loads score[] with the scores of all parses in s,
  *! and sets max_correct_score and max_score.  Returns the index of the
  *! last highest scoring parse.
@@ -123,11 +175,12 @@ void sentence_scores(sentence_type *s, const Float w[], Float score[],
 
 size_type max_score_index(const sentence_type *s, const Float w[]) {
   size_type i, max_i = 0;
-  Float max_score = parse_score(&s->parse[0], w);
-  assert(finite(max_score));
+  Float *lw = s->lf == NULL ? NULL : MALLOC(s->nlf*sizeof(Float));
+  Float max_score;
 
-  if (s->nparses <= 1)
-    return 0;
+  w = sentence_weights(s, w, lw);
+  max_score = parse_score(&s->parse[0], w);
+  assert(finite(max_score));
 
   for (i = 1; i < s->nparses; ++i) {
     Float score = parse_score(&s->parse[i], w);
@@ -137,6 +190,7 @@ size_type max_score_index(const sentence_type *s, const Float w[]) {
       max_score = score;
     }
   }
+  FREE(lw);
   return max_i;
 }  /* max_score_index */
 
@@ -329,39 +383,16 @@ static void read_parse(FILE *in, parse_type *p, feature_type *fmax) {
 }  /* read_parse() */
 
 
-/*! read_sentence() reads a sentence, normalizes pwinner on parses,
- *!  and updates maxnparses.
+/*! sentence_winners() finds the parses of s with the best f-score,
+ *!  sets Pyx on its parses according to flags, and sets Px and
+ *!  correct_index; Px is 0 when there is no winner.
  */
 
-int read_sentence(corpusflags_type *flags, FILE *in, sentence_type *s, 
-		  feature_type *fmax, int *maxnparses) {
-  int i, nread, best_fscore_index = -1, nwinners = 0;
+static void sentence_winners(corpusflags_type *flags, sentence_type *s) {
+  int i, best_fscore_index = -1, nwinners = 0;
   DataFloat fscore, best_logprob = -DATAFLOAT_MAX, best_fscore = -1;
 
-  nread = fscanf(in, " G = " DATAFLOAT_FORMAT " ", &s->g);
-  if (nread == EOF)
-    return EOF;
-  assert(nread == 0 || nread == 1);
-  if (nread == 0)
-    s->g = 1;
-
-  nread = fscanf(in, " N = %d", &s->nparses);
-  if (nread == EOF)
-    return EOF;
-  assert(nread == 1);
-  assert(s->nparses >= 0);
-  if (s->nparses > *maxnparses)
-    *maxnparses = s->nparses;
-
-  if (s->nparses > 0) {
-    s->parse = SMALLOC(s->nparses*sizeof(parse_type));
-    assert(s->parse != NULL);
-  }
-  else
-    s->parse = NULL;
-
   for (i = 0; i < s->nparses; ++i) {
-    read_parse(in, &s->parse[i], fmax);
     // handle the admittedly strange case where a parse has no brackets
     if (s->parse[i].w == 0.0 || s->parse[i].p == 0.0) {
       fscore = 0.0;
@@ -439,16 +470,325 @@ int read_sentence(corpusflags_type *flags, FILE *in, sentence_type *s,
        when we have parse failures and the parser returns
        a flat bracketing. */
   }
+}  /* sentence_winners() */
+
+/*! read_sentence() reads a sentence, normalizes pwinner on parses,
+ *!  and updates maxnparses.
+ */
+
+int read_sentence(corpusflags_type *flags, FILE *in, sentence_type *s, 
+		  feature_type *fmax, int *maxnparses) {
+  int i, nread;
+
+  s->lf = NULL;
+  s->nlf = 0;
+
+  nread = fscanf(in, " G = " DATAFLOAT_FORMAT " ", &s->g);
+  if (nread == EOF)
+    return EOF;
+  assert(nread == 0 || nread == 1);
+  if (nread == 0)
+    s->g = 1;
+
+  nread = fscanf(in, " N = %d", &s->nparses);
+  if (nread == EOF)
+    return EOF;
+  assert(nread == 1);
+  assert(s->nparses >= 0);
+  if (s->nparses > *maxnparses)
+    *maxnparses = s->nparses;
+
+  if (s->nparses > 0) {
+    s->parse = SMALLOC(s->nparses*sizeof(parse_type));
+    assert(s->parse != NULL);
+  }
+  else
+    s->parse = NULL;
+
+  for (i = 0; i < s->nparses; ++i)
+    read_parse(in, &s->parse[i], fmax);
 
+  sentence_winners(flags, s);
   return s->nparses;
 }  /* read_sentence() */
 
+/***********************************************************************
+ *                                                                     *
+ *                       binary corpus files                           *
+ *                                                                     *
+ ***********************************************************************/
+
+/* A binary corpus file holds a corpus that read_corpus() has already
+ * parsed: a header, then one record per sentence, one record per parse,
+ * and the f[] and fc[] arrays of all the parses concatenated in order.
+ * Numbers are in the native byte order.  Each section starts at a
+ * multiple of 8 bytes, so the arrays can be used where they lie in a
+ * mapping of the file.  Pyx, Px and correct_index are not stored; they
+ * depend on the corpusflags and are recomputed when the file is read.
+ * The header records the byte order and the sizes of the stored types,
+ * so a file compiled on a different machine or with different typedefs
+ * in lmdata.h is rejected rather than misread.
+ */
+
+#define CORPUS_MAGIC "\177lmdata2"    /* 8 bytes; no text file starts with \177 */
+#define CORPUS_BYTEORDER 0x01020304
+
+typedef struct {
+  char      magic[8];
+  uint32_t  byteorder;     /* CORPUS_BYTEORDER in the writer's byte order */
+  uint8_t   feature_size;  /* sizeof(feature_type) */
+  uint8_t   fc_size;       /* sizeof(fc_type) */
+  uint8_t   float_size;    /* sizeof(DataFloat) */
+  uint8_t   size_size;     /* sizeof(size_type) */
+  uint64_t  nsentences;
+  uint64_t  nparses;       /* parses in all sentences */
+  uint64_t  nf;            /* count 1 features in all parses */
+  uint64_t  nfc;           /* feature counts in all parses */
+  size_type nfeatures;
+  size_type maxnparses;
+} corpus_header_type;
+
+typedef struct {
+  DataFloat g;
+  size_type nparses;
+} sentence_record_type;
+
+typedef struct {
+  DataFloat p;
+  DataFloat w;
+  size_type nf;
+  size_type nfc;
+} parse_record_type;
+
+#define ALIGN8(n)  (((n) + 7) & ~(uint64_t) 7)
+
+static void write_or_die(const void *p, size_t n, FILE *out) {
+  if (n > 0 && fwrite(p, n, 1, out) != 1) {
+    fprintf(stderr, "## Error: failed to write binary corpus\n");
+    exit(EXIT_FAILURE);
+  }
+}  /* write_or_die() */
+
+void write_corpus_binary(const corpus_type *c, FILE *out) {
+  static const char zeros[8] = { 0 };
+  corpus_header_type h;
+  size_type i, j;
+
+  if (c->maxnlf > 0) {
+    fprintf(stderr, "## Error: can't write a packed corpus in binary format\n");
+    exit(EXIT_FAILURE);
+  }
+
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, CORPUS_MAGIC, sizeof(h.magic));
+  h.byteorder = CORPUS_BYTEORDER;
+  h.feature_size = sizeof(feature_type);
+  h.fc_size = sizeof(fc_type);
+  h.float_size = sizeof(DataFloat);
+  h.size_size = sizeof(size_type);
+  h.nsentences = c->nsentences;
+  h.nfeatures = c->nfeatures;
+  h.maxnparses = c->maxnparses;
+  for (i = 0; i < c->nsentences; ++i) {
+    const sentence_type *s = &c->sentence[i];
+    h.nparses += s->nparses;
+    for (j = 0; j < s->nparses; ++j) {
+      h.nf += s->parse[j].nf;
+      h.nfc += s->parse[j].nfc;
+    }
+  }
+  write_or_die(&h, sizeof(h), out);
+
+  for (i = 0; i < c->nsentences; ++i) {
+    sentence_record_type sr;
+    sr.g = c->sentence[i].g;
+    sr.nparses = c->sentence[i].nparses;
+    write_or_die(&sr, sizeof(sr), out);
+  }
+
+  for (i = 0; i < c->nsentences; ++i) 
+    for (j = 0; j < c->sentence[i].nparses; ++j) {
+      const parse_type *p = &c->sentence[i].parse[j];
+      parse_record_type pr;
+      pr.p = p->p;
+      pr.w = p->w;
+      pr.nf = p->nf;
+      pr.nfc = p->nfc;
+      write_or_die(&pr, sizeof(pr), out);
+    }
+
+  for (i = 0; i < c->nsentences; ++i) 
+    for (j = 0; j < c->sentence[i].nparses; ++j) {
+      const parse_type *p = &c->sentence[i].parse[j];
+      write_or_die(p->f, p->nf*sizeof(feature_type), out);
+    }
+  write_or_die(zeros, ALIGN8(h.nf*sizeof(feature_type)) - h.nf*sizeof(feature_type), out);
+
+  for (i = 0; i < c->nsentences; ++i) 
+    for (j = 0; j < c->sentence[i].nparses; ++j) {
+      const parse_type *p = &c->sentence[i].parse[j];
+      write_or_die(p->fc, p->nfc*sizeof(fc_type), out);
+    }
+
+  if (fflush(out) != 0) {
+    fprintf(stderr, "## Error: failed to write binary corpus\n");
+    exit(EXIT_FAILURE);
+  }
+}  /* write_corpus_binary() */
+
+/*! binary_corpus_data() returns the contents of the binary corpus
+ *!  file in, whose first byte has already been read.  A regular file
+ *!  is mapped privately (so the data is never copied unless it is
+ *!  written to); anything else, e.g., a pipe from zcat, is read into
+ *!  memory.  The data is never freed.
+ */
+
+static char *binary_corpus_data(FILE *in, size_t *size) {
+  struct stat st;
+  char *data;
+  size_t n, max_size;
+
+  if (fstat(fileno(in), &st) == 0 && S_ISREG(st.st_mode) && ftell(in) == 1) {
+    data = mmap(NULL, st.st_size, PROT_READ|PROT_WRITE, MAP_PRIVATE, fileno(in), 0);
+    if (data != MAP_FAILED) {
+      *size = st.st_size;
+      return data;
+    }
+  }
+
+  max_size = 1 << 20;
+  data = MALLOC(max_size);
+  assert(data != NULL);
+  data[0] = CORPUS_MAGIC[0];
+  *size = 1;
+  while ((n = fread(data + *size, 1, max_size - *size, in)) > 0) {
+    *size += n;
+    if (*size == max_size) {
+      max_size *= 2;
+      data = REALLOC(data, max_size);
+      assert(data != NULL);
+    }
+  }
+  return data;
+}  /* binary_corpus_data() */
+
+/*! read_corpus_binary() reads the binary corpus file in, whose first
+ *!  byte has already been read.  The parses' f[] and fc[] arrays point
+ *!  into the file's data; the only allocations are one array of
+ *!  sentences and one array of parses.
+ */
+
+static corpus_type *read_corpus_binary(corpusflags_type *flags, FILE *in) {
+  size_t size;
+  char *data = binary_corpus_data(in, &size);
+  const corpus_header_type *h = (const corpus_header_type *) data;
+  const sentence_record_type *sr;
+  const parse_record_type *pr;
+  feature_type *fp;
+  fc_type *fcp;
+  parse_type *parses, *parses0;
+  uint64_t i, j, offset;
+  size_type nloserparses = 0;
+  Float sum_g = 0;
+
+  if (size < sizeof(*h) || memcmp(h->magic, CORPUS_MAGIC, sizeof(h->magic)) != 0) {
+    fprintf(stderr, "## Error: bad binary corpus header; "
+	    "it may be from an older compile-corpus, so rerun compile-corpus\n");
+    exit(EXIT_FAILURE);
+  }
+  if (h->byteorder != CORPUS_BYTEORDER) {
+    fprintf(stderr, "## Error: binary corpus was written with a different byte order; "
+	    "rerun compile-corpus on this machine\n");
+    exit(EXIT_FAILURE);
+  }
+  if (h->feature_size != sizeof(feature_type) || h->fc_size != sizeof(fc_type)
+      || h->float_size != sizeof(DataFloat) || h->size_size != sizeof(size_type)) {
+    fprintf(stderr, "## Error: binary corpus has feature_type, fc_type, DataFloat and "
+	    "size_type of %d, %d, %d and %d bytes, but this program uses "
+	    "%d, %d, %d and %d; rerun compile-corpus\n",
+	    h->feature_size, h->fc_size, h->float_size, h->size_size,
+	    (int) sizeof(feature_type), (int) sizeof(fc_type),
+	    (int) sizeof(DataFloat), (int) sizeof(size_type));
+    exit(EXIT_FAILURE);
+  }
+  offset = sizeof(*h);
+  sr = (const sentence_record_type *) (data + offset);
+  offset += ALIGN8(h->nsentences*sizeof(*sr));
+  pr = (const parse_record_type *) (data + offset);
+  offset += ALIGN8(h->nparses*sizeof(*pr));
+  fp = (feature_type *) (data + offset);
+  offset += ALIGN8(h->nf*sizeof(*fp));
+  fcp = (fc_type *) (data + offset);
+  offset += h->nfc*sizeof(*fcp);
+  if (offset != size) {
+    fprintf(stderr, "## Error: binary corpus is %lu bytes, expected %lu\n",
+	    (unsigned long) size, (unsigned long) offset);
+    exit(EXIT_FAILURE);
+  }
+
+  corpus_type *c = SMALLOC(sizeof(corpus_type));
+  assert(c != NULL);
+  c->sentence = MALLOC(h->nsentences*sizeof(sentence_type));
+  assert(h->nsentences == 0 || c->sentence != NULL);
+  parses = parses0 = MALLOC(h->nparses*sizeof(parse_type));
+  assert(h->nparses == 0 || parses != NULL);
+
+  c->nsentences = 0;
+  for (i = 0; i < h->nsentences; ++i, ++sr) {
+    sentence_type *s = &c->sentence[c->nsentences];
+    s->g = sr->g;
+    s->nparses = sr->nparses;
+    s->parse = s->nparses > 0 ? parses : NULL;
+    s->lf = NULL;
+    s->nlf = 0;
+    for (j = 0; j < s->nparses; ++j, ++pr) {
+      parse_type *p = parses++;
+      p->p = pr->p;
+      p->w = pr->w;
+      p->nf = pr->nf;
+      p->f = p->nf > 0 ? fp : NULL;
+      fp += p->nf;
+      p->nfc = pr->nfc;
+      p->fc = p->nfc > 0 ? fcp : NULL;
+      fcp += p->nfc;
+    }
+    sentence_winners(flags, s);
+    if (s->Px == 0.0 && s->nparses != 0)
+      continue;
+    ++c->nsentences;
+    sum_g += s->g;
+    if (s->Px > 0)
+      nloserparses += s->nparses - 1;
+  }
+  assert(parses == parses0 + h->nparses);
+  assert((char *) fcp == data + size);
+  c->nfeatures = h->nfeatures;
+  c->maxnparses = h->maxnparses;
+  c->nloserparses = nloserparses;
+  c->maxnlf = 0;
+
+  if (flags && flags->Px_propto_g)
+    for (i = 0; i < c->nsentences; ++i)  /* normalize Px */
+      c->sentence[i].Px *= c->nsentences * c->sentence[i].g / sum_g;
+
+  if (flags && flags->packed)
+    pack_corpus(c);
+
+  return c;
+}  /* read_corpus_binary() */
+
 corpus_type *read_corpus(corpusflags_type *flags, FILE *in) {
   sentence_type s;
   feature_type fmax = 0;
   int nread, i = 0, maxnparses = 0, nloserparses = 0;
   Float sum_g = 0;
 
+  int ch = getc(in);
+  if (ch == CORPUS_MAGIC[0])
+    return read_corpus_binary(flags, in);
+  if (ch != EOF)
+    ungetc(ch, in);
+
   /* allocate feature counts */
   read_parse_nfc_max = MIN_NFC;
   read_parse_fcp = MALLOC(read_parse_nfc_max*sizeof(fc_type));
@@ -492,11 +832,15 @@ corpus_type *read_corpus(corpusflags_type *flags, FILE *in) {
   c->nfeatures = fmax+1;
   c->maxnparses = maxnparses;
   c->nloserparses = nloserparses;
+  c->maxnlf = 0;
 
   if (flags && flags->Px_propto_g)
     for (i = 0; i < c->nsentences; ++i)  /* normalize Px */
       c->sentence[i].Px *= c->nsentences * c->sentence[i].g / sum_g;
 
+  if (flags && flags->packed)
+    pack_corpus(c);
+
   FREE(read_parse_fcp);
   FREE(read_parse_fp);
 
@@ -504,43 +848,246 @@ corpus_type *read_corpus(corpusflags_type *flags, FILE *in) {
 }  /* read_corpus() */
 
 corpus_type *read_corpus_file(corpusflags_type *flags, const char* filename) {
-  const char* filesuffix = strrchr(filename, '.');
-  char *command = NULL;
-  FILE *in;
+  FILE *in = zfopen(filename, "r");
   corpus_type *corpus;
-  if (strcasecmp(filesuffix, ".bz2") == 0) {
-    const char bzcat[] = "bzcat ";
-    command = malloc(sizeof(bzcat)+strlen(filename)+1);
-    strcpy(command, bzcat);
-    strcat(command, filename);
-    in = popen(command, "r");
-  }
-  else if (strcasecmp(filesuffix, ".gz") == 0) {
-    const char zcat[] = "gunzip -c ";
-    command = malloc(sizeof(zcat)+strlen(filename)+1);
-    strcpy(command, zcat);
-    strcat(command, filename);
-    in = popen(command, "r");
-  }
-  else
-    in = fopen(filename, "r");
   if (in == NULL) {
-    if (command == NULL) 
-      fprintf(stderr, "## Error: couldn't open corpus file %s\n", filename);
-    else
-      fprintf(stderr, "## Error: couldn't popen command %s\n", command);
+    fprintf(stderr, "## Error: couldn't open corpus file %s\n", filename);
     exit(EXIT_FAILURE);
   }
   corpus = read_corpus(flags, in);
-  if (command != NULL) {
-    free(command);
-    pclose(in);
-  }
-  else
-    fclose(in);
+  fclose(in);
   return corpus;
 }  /* read_corpus_file() */
 
+/***********************************************************************
+ *                                                                     *
+ *                          pack_corpus()                              *
+ *                                                                     *
+ ***********************************************************************/
+
+/* The parses of a sentence share most of their features, so the
+ * packed functions below fetch each feature's weight once per
+ * sentence rather than once per parse, and the parses then read
+ * their weights from a small array that stays in the cache.  The
+ * parses' feature arrays are already laid out one sentence after
+ * another (by blockalloc or in the binary corpus file), so packing
+ * just rewrites them in place.
+ */
+
+/*! local_feature() returns the index in lf[] of feature f, adding f to
+ *!  lf[] if it isn't there yet.  The hash table ht[] of nht (a power
+ *!  of 2) entries maps features to indices + 1, with 0 for no entry.
+ */
+
+__inline__ static
+feature_type local_feature(feature_type f, feature_type lf[], size_type *nlf,
+			   size_type ht[], size_type nht) {
+  size_type h = (f * 2654435761U) & (nht - 1);
+  while (ht[h] != 0) {
+    if (lf[ht[h]-1] == f)
+      return ht[h]-1;
+    h = (h + 1) & (nht - 1);
+  }
+  lf[*nlf] = f;
+  ht[h] = ++*nlf;
+  return *nlf - 1;
+}  /* local_feature() */
+
+void pack_corpus(corpus_type *c) {
+  size_type lf_max = 0, nht_max = 0, i, j, k;
+  feature_type *lf = NULL;
+  size_type *ht = NULL;
+
+  for (i = 0; i < c->nsentences; ++i) {
+    sentence_type *s = &c->sentence[i];
+    size_type n = 0, nht = 1, nlf = 0;
+
+    if (s->lf != NULL)    /* already packed */
+      continue;
+
+    for (j = 0; j < s->nparses; ++j) 
+      n += s->parse[j].nf + s->parse[j].nfc;
+    if (n > lf_max) {
+      lf_max = n;
+      lf = REALLOC(lf, lf_max*sizeof(feature_type));
+      assert(lf != NULL);
+    }
+    while (nht < 2*n)
+      nht *= 2;
+    if (nht > nht_max) {
+      nht_max = nht;
+      ht = REALLOC(ht, nht_max*sizeof(size_type));
+      assert(ht != NULL);
+    }
+    memset(ht, 0, nht*sizeof(size_type));
+
+    for (j = 0; j < s->nparses; ++j) {
+      parse_type *p = &s->parse[j];
+      for (k = 0; k < p->nf; ++k)
+	p->f[k] = local_feature(p->f[k], lf, &nlf, ht, nht);
+      for (k = 0; k < p->nfc; ++k)
+	p->fc[k].f = local_feature(p->fc[k].f, lf, &nlf, ht, nht);
+    }
+
+    s->lf = SMCOPY(lf, nlf*sizeof(feature_type));
+    assert(nlf == 0 || s->lf != NULL);
+    s->nlf = nlf;
+    if (nlf > c->maxnlf)
+      c->maxnlf = nlf;
+  }
+
+  FREE(ht);
+  FREE(lf);
+}  /* pack_corpus() */
+
+/***********************************************************************
+ *                                                                     *
+ *                  parallel gradient accumulation                     *
+ *                                                                     *
+ ***********************************************************************/
+
+/* The *_corpus_stats() functions divide the sentences among OpenMP
+ * threads.  Each thread accumulates its sentences' derivatives in its
+ * own array (thread 0 uses the caller's array), and then the threads
+ * sum the arrays together, each thread summing a different range of
+ * features.  This needs no lock, and the summation takes time
+ * proportional to nfeatures rather than nfeatures * nthreads.  With a
+ * given number of threads the results do not vary from run to run.
+ */
+
+#define REDUCE_BLOCK 4096  /* features summed per reduction block */
+
+/*! thread_gradient() returns the array in which the calling thread
+ *!  should accumulate derivatives: dL_dw[] itself for thread 0, and
+ *!  a new zeroed array for the other threads.  It records the array
+ *!  in thread_dL_dw[], which must have room for every thread in the
+ *!  team.
+ */
+
+static Float *thread_gradient(Float *thread_dL_dw[], Float dL_dw[], size_type n) {
+  Float *local_dL_dw = dL_dw;
+#ifdef _OPENMP
+  int t = omp_get_thread_num();
+  if (t != 0) {
+    local_dL_dw = CALLOC(n, sizeof(Float));
+    assert(n == 0 || local_dL_dw != NULL);
+  }
+  thread_dL_dw[t] = local_dL_dw;
+#endif
+  return local_dL_dw;
+}  /* thread_gradient() */
+
+/*! reduce_thread_gradients() adds the arrays of threads 1, 2, ... in
+ *!  thread_dL_dw[] to dL_dw[] and frees them.  It must be called by
+ *!  every thread of the team after they have all finished accumulating
+ *!  (e.g., after the implicit barrier of an omp for).
+ */
+
+static void reduce_thread_gradients(Float *thread_dL_dw[], Float dL_dw[], size_type n) {
+#ifdef _OPENMP
+  int nthreads = omp_get_num_threads(), t;
+  size_type b, nblocks = (n + REDUCE_BLOCK - 1) / REDUCE_BLOCK;
+
+# pragma omp for schedule(static)
+  for (b = 0; b < nblocks; ++b) {
+    size_type k, k0 = b * REDUCE_BLOCK;
+    size_type k1 = (k0 + REDUCE_BLOCK < n) ? k0 + REDUCE_BLOCK : n;
+    for (t = 1; t < nthreads; ++t) {
+      const Float *local_dL_dw = thread_dL_dw[t];
+      for (k = k0; k < k1; ++k)
+	dL_dw[k] += local_dL_dw[k];
+    }
+  }  /* implicit barrier: all threads have finished reading */
+
+  t = omp_get_thread_num();
+  if (t != 0)
+    FREE(thread_dL_dw[t]);
+#endif
+}  /* reduce_thread_gradients() */
+
+/*! thread_gradients() allocates room for every thread's array */
+
+static Float **thread_gradients(void) {
+#ifdef _OPENMP
+  Float **thread_dL_dw = MALLOC(omp_get_max_threads()*sizeof(Float *));
+  assert(thread_dL_dw != NULL);
+  return thread_dL_dw;
+#else
+  return NULL;
+#endif
+}  /* thread_gradients() */
+
+typedef Float (*sentence_stats_type)(sentence_type *s, const Float w[], 
+				     Float score[], Float dL_dw[],
+				     Float *sum_g, Float *sum_p, Float *sum_w);
+
+/*! packed_sentence_stats() returns sentence_stats() on s, using the
+ *!  scratch arrays lw[] and ldL_dw[] (of c->maxnlf elements) if s is
+ *!  packed.
+ */
+
+__inline__ static
+Float packed_sentence_stats(sentence_stats_type sentence_stats, sentence_type *s,
+			    const Float w[], Float score[], Float dL_dw[],
+			    Float lw[], Float ldL_dw[],
+			    Float *sum_g, Float *sum_p, Float *sum_w)
+{
+  Float *sdL_dw = sentence_gradient(s, dL_dw, ldL_dw);
+  Float L = sentence_stats(s, sentence_weights(s, w, lw), score, sdL_dw,
+			   sum_g, sum_p, sum_w);
+  add_sentence_gradient(s, sdL_dw, dL_dw);
+  return L;
+}  /* packed_sentence_stats() */
+
+/*! sum_sentence_stats() sums sentence_stats() over the sentences of c,
+ *!  setting dL_dw[] to the sum of their derivatives and sum_g, sum_p
+ *!  and sum_w to the sums of their precision/recall counts.
+ */
+
+static Float sum_sentence_stats(corpus_type *c, sentence_stats_type sentence_stats,
+				const Float w[], Float dL_dw[], 
+				Float *sum_g, Float *sum_p, Float *sum_w)
+{
+  Float L = 0, g = 0, p = 0, nw = 0;
+  Float **thread_dL_dw = thread_gradients();
+  int i;
+
+  for (i = 0; i < c->nfeatures; ++i)     /* zero dL_dw[] */
+    dL_dw[i] = 0;
+
+#ifdef _OPENMP
+# pragma omp parallel default(shared) reduction(+: L, g, p, nw)
+#endif
+  {
+    Float *local_dL_dw = thread_gradient(thread_dL_dw, dL_dw, c->nfeatures);
+    Float *score = MALLOC(c->maxnparses*sizeof(Float));
+    Float *lw = MALLOC(c->maxnlf*sizeof(Float));
+    Float *ldL_dw = MALLOC(c->maxnlf*sizeof(Float));
+    int j;
+
+    assert(score != NULL);
+    assert(c->maxnlf == 0 || (lw != NULL && ldL_dw != NULL));
+
+#ifdef _OPENMP
+# pragma omp for schedule(static)
+#endif
+    for (j = 0; j < c->nsentences; ++j)    /* collect stats from sentences */
+      L += packed_sentence_stats(sentence_stats, &c->sentence[j], w, score, local_dL_dw,
+				 lw, ldL_dw, &g, &p, &nw);
+
+    FREE(ldL_dw);
+    FREE(lw);
+    FREE(score);
+    reduce_thread_gradients(thread_dL_dw, dL_dw, c->nfeatures);
+  }
+
+  FREE(thread_dL_dw);
+  *sum_g = g;
+  *sum_p = p;
+  *sum_w = nw;
+  return L;
+}  /* sum_sentence_stats() */
+
 /***********************************************************************
  *                                                                     *
  *                      linear logistic regression                     *
@@ -621,20 +1168,7 @@ Float sentence_stats(sentence_type *s, const Float w[], Float score[], Float E_E
 Float corpus_stats(corpus_type *c, const Float w[], Float E_Ew[], 
 		   Float *sum_g, Float *sum_p, Float *sum_w) 
 {
-  Float neglogP = 0;
-  Float *score = MALLOC(c->maxnparses*sizeof(Float));
-  int i;
-
-  assert(score != NULL);
-
-  *sum_g = *sum_p = *sum_w = 0;          /* zero precision/recall counters */
-  for (i = 0; i < c->nfeatures; ++i)     /* zero Ew_E[] */
-    E_Ew[i] = 0;
-  for (i = 0; i < c->nsentences; ++i)    /* collect stats from sentences */
-    neglogP += sentence_stats(&c->sentence[i], w, score, E_Ew, 
-			      sum_g, sum_p, sum_w);
-  FREE(score);
-  return neglogP;
+  return sum_sentence_stats(c, sentence_stats, w, E_Ew, sum_g, sum_p, sum_w);
 }  /* corpus_stats() */
 
 
@@ -723,58 +1257,7 @@ Float emll_sentence_stats(sentence_type *s, const Float w[],
 Float emll_corpus_stats(corpus_type *c, const Float w[], Float dL_dw[], 
 			Float *sum_g, Float *sum_p, Float *sum_w) 
 {
-  Float neglogP = 0;
-  int i;
-
-  *sum_g = *sum_p = *sum_w = 0;          /* zero precision/recall counters */
-  for (i = 0; i < c->nfeatures; ++i)     /* zero dL_dw[] */
-    dL_dw[i] = 0;
-
-#ifdef _OPENMP
-# pragma omp parallel default(shared)
-  {
-    int j;
-    /* Float score[c->maxnparses]; 
-       Float local_dL_dw[c->nfeatures]; */ /* works, but stack needs to be very large */
-    Float *local_dL_dw = MALLOC(c->nfeatures*sizeof(Float));
-    Float *score = MALLOC(c->maxnparses*sizeof(Float));
-    Float local_sum_g = 0, local_sum_p = 0, local_sum_w = 0, local_neglogP = 0;
-
-    for (j = 0; j < c->nfeatures; ++j)
-      local_dL_dw[j] = 0;
-    
-# pragma omp for
-    for (j = 0; j < c->nsentences; ++j)    /* collect stats from sentences */
-      local_neglogP += emll_sentence_stats(&c->sentence[j], w, score, local_dL_dw, 
-					   &local_sum_g, &local_sum_p, &local_sum_w);
-
-    FREE(score);
-
-# pragma omp critical (lmdata_emll_corpus_stats)
-    {
-      neglogP += local_neglogP;
-      *sum_g += local_sum_g;
-      *sum_p += local_sum_p;
-      *sum_w += local_sum_w;
-      for (j = 0; j < c->nfeatures; ++j)
-	dL_dw[j] += local_dL_dw[j];
-    }
-    
-    FREE(local_dL_dw);
-  }  /* pragma omp parallel */
-#else
-  {
-    /* Float score[c->maxnparses]; */
-    Float *score = MALLOC(c->maxnparses*sizeof(Float));
-
-    for (i = 0; i < c->nsentences; ++i)    /* collect stats from sentences */
-      neglogP += emll_sentence_stats(&c->sentence[i], w, score, dL_dw, 
-				     sum_g, sum_p, sum_w);
-
-    FREE(score);
-  }
-#endif
-  return neglogP;
+  return sum_sentence_stats(c, emll_sentence_stats, w, dL_dw, sum_g, sum_p, sum_w);
 }  /* emll_corpus_stats() */
 
 /*! emll_corpus_stats_noomp() returns the EM-like log loss - E_P~(x)[log E_w[P~|x]],
@@ -795,9 +1278,13 @@ Float emll_corpus_stats_noomp(corpus_type *c, const Float w[], Float dL_dw[],
 
   {
     Float *score = MALLOC(c->maxnparses*sizeof(Float));
+    Float *lw = MALLOC(c->maxnlf*sizeof(Float));
+    Float *ldL_dw = MALLOC(c->maxnlf*sizeof(Float));
     for (i = 0; i < c->nsentences; ++i)    /* collect stats from sentences */
-      neglogP += emll_sentence_stats(&c->sentence[i], w, score, dL_dw, 
-				     sum_g, sum_p, sum_w);
+      neglogP += packed_sentence_stats(emll_sentence_stats, &c->sentence[i], w, score, 
+				       dL_dw, lw, ldL_dw, sum_g, sum_p, sum_w);
+    FREE(ldL_dw);
+    FREE(lw);
     FREE(score);
   }
   return neglogP;
@@ -891,20 +1378,7 @@ Float pwlog_sentence_stats(sentence_type *s, const Float w[],
 Float pwlog_corpus_stats(corpus_type *c, const Float w[], Float dL_dw[], 
 			Float *sum_g, Float *sum_p, Float *sum_w)
 {
-  Float L = 0;  /* loss */
-  Float *score = MALLOC(c->maxnparses*sizeof(Float));
-  int i;
-
-  assert(score != NULL);
-
-  *sum_g = *sum_p = *sum_w = 0;          /* zero precision/recall counters */
-  for (i = 0; i < c->nfeatures; ++i)     /* zero dL_dw[] */
-    dL_dw[i] = 0;
-  for (i = 0; i < c->nsentences; ++i)    /* collect stats from sentences */
-    L += pwlog_sentence_stats(&c->sentence[i], w, score, dL_dw, 
-			      sum_g, sum_p, sum_w);
-  FREE(score);
-  return L;
+  return sum_sentence_stats(c, pwlog_sentence_stats, w, dL_dw, sum_g, sum_p, sum_w);
 }  /* pwlog_corpus_stats() */
 
 
@@ -923,6 +1397,7 @@ Float margins(corpus_type *c, const Float w[], Float m[],
 	      Float *sum_g, Float *sum_p, Float *sum_w) 
 {
   Float min_margin = FLOAT_MAX;
+  Float *lw = MALLOC(c->maxnlf*sizeof(Float));
   size_type i, j, im = 0;
   *sum_g = *sum_p = *sum_w = 0;          /* zero precision/recall counters */
   
@@ -931,13 +1406,14 @@ Float margins(corpus_type *c, const Float w[], Float m[],
     *sum_g += s->g;
 
     if (s->Px > 0) {
-      Float correct_score = parse_score(&s->parse[s->correct_index], w);
+      const Float *sw = sentence_weights(s, w, lw);
+      Float correct_score = parse_score(&s->parse[s->correct_index], sw);
       Float best_score = correct_score;
       size_type best_index = s->correct_index;
 
       for (j = 0; j < s->nparses; ++j) 
 	if (j != s->correct_index) {
-	  Float score = parse_score(&s->parse[j], w);
+	  Float score = parse_score(&s->parse[j], sw);
 	  Float margin = correct_score - score;
 	  if (score >= best_score) {
 	    best_index = j;
@@ -953,6 +1429,7 @@ Float margins(corpus_type *c, const Float w[], Float m[],
     }
   }
   assert(im == c->nloserparses);
+  FREE(lw);
   return min_margin;
 }  // margins()
 
@@ -968,10 +1445,12 @@ Float log_exp_corpus_stats(corpus_type *c, const Float w[], Float dL_dw[],
 {
   size_type n = c->nloserparses;
   Float *m = MALLOC(n*sizeof(Float));
+  Float *ldL_dw = MALLOC(c->maxnlf*sizeof(Float));
   Float L, Lm = 0, min_m;
   int i, j, k, mi;
 
   assert(m != NULL);
+  assert(c->maxnlf == 0 || ldL_dw != NULL);
 
   for (k = 0; k < c->nfeatures; ++k)     /* zero dL_dw[] */
     dL_dw[k] = 0;
@@ -989,26 +1468,29 @@ Float log_exp_corpus_stats(corpus_type *c, const Float w[], Float dL_dw[],
   for (i = 0; i < c->nsentences; ++i) {
     sentence_type *s = &c->sentence[i];
     if (s->Px > 0) {
+      Float *sdL_dw = sentence_gradient(s, dL_dw, ldL_dw);
       Float c_sum = 0;
       for (j = 0; j < s->nparses; ++j) 
 	if (j != s->correct_index) {
 	  Float c = exp(min_m - m[mi++])/Lm;
 	  c_sum += c;
 	  for (k = 0; k < s->parse[j].nf; ++k)   /* 1 count features */
-	    dL_dw[s->parse[j].f[k]] += c;
+	    sdL_dw[s->parse[j].f[k]] += c;
 	  for (k = 0; k < s->parse[j].nfc; ++k)  /* arbitrary count features */
-	    dL_dw[s->parse[j].fc[k].f] += c * s->parse[j].fc[k].c;
+	    sdL_dw[s->parse[j].fc[k].f] += c * s->parse[j].fc[k].c;
 	}
       for (k = 0; k < s->parse[s->correct_index].nf; ++k)
-	dL_dw[s->parse[s->correct_index].f[k]] -= c_sum;
+	sdL_dw[s->parse[s->correct_index].f[k]] -= c_sum;
       for (k = 0; k < s->parse[s->correct_index].nfc; ++k)
-	dL_dw[s->parse[s->correct_index].fc[k].f] 
+	sdL_dw[s->parse[s->correct_index].fc[k].f] 
 	  -= c_sum * s->parse[s->correct_index].fc[k].c;
+      add_sentence_gradient(s, sdL_dw, dL_dw);
     }
   }
 
   assert(mi == n);
 
+  FREE(ldL_dw);
   FREE(m);
   return L;
 }  /* log_exp_corpus_stats() */
@@ -1020,79 +1502,81 @@ Float log_exp_corpus_stats(corpus_type *c, const Float w[], Float dL_dw[],
  *                                                                     *
  ***********************************************************************/
 
-/*! exp_corpus_stats() returns the exp loss for the corpus
- *! c, sets dL_dw[j] to the derivative of the log exp loss for feature
- *! weight w[j], and sets the precision/recall statistics sum_g, sum_p
- *! and sum_w.
+/*! exp_sentence_stats() returns the exp loss for sentence s, increments
+ *!  dL_dw[j] with its derivative for feature weight w[j], and increments
+ *!  the precision/recall statistics sum_g, sum_p and sum_w.
  */
 
-Float exp_corpus_stats(corpus_type *c, const Float w[], Float dL_dw[], 
-		       Float *sum_g, Float *sum_p, Float *sum_w)
+static Float exp_sentence_stats(sentence_type *s, const Float w[], 
+				Float scores[], Float dL_dw[],
+				Float *sum_g, Float *sum_p, Float *sum_w)
 {
   Float L = 0;
-  int i, j, k, im = 0;
+  int j, k;
   const Float margin_cutoff = -log(FLOAT_MAX/2)/2;
 
-  *sum_g = *sum_p = *sum_w = 0;          /* zero precision/recall counters */
-
-  for (k = 0; k < c->nfeatures; ++k)     /* zero dL_dw[] */
-    dL_dw[k] = 0;
-
-  for (i = 0; i < c->nsentences; ++i) {
-    sentence_type *s = &c->sentence[i];
-    *sum_g += s->g;
-
-    if (s->Px > 0) {
-      Float correct_score = parse_score(&s->parse[s->correct_index], w);
-      Float best_score = correct_score;
-      size_type best_index = s->correct_index;
-      Float sum_exp_nmargin = 0;
-      assert(s->correct_index < s->nparses);
-
-      for (j = 0; j < s->nparses; ++j) 
-	if (j != s->correct_index) {
-	  Float score = parse_score(&s->parse[j], w);
-	  Float margin = correct_score - score;
-	  Float exp_nmargin;
+  *sum_g += s->g;
 
-	  if (score >= best_score) {     /* save best score */
-	    best_index = j;
-	    best_score = score;
-	  }
-	  ++im;                          /* count number of incorrect parses */
+  if (s->Px > 0) {
+    Float correct_score = parse_score(&s->parse[s->correct_index], w);
+    Float best_score = correct_score;
+    size_type best_index = s->correct_index;
+    Float sum_exp_nmargin = 0;
+    assert(s->correct_index < s->nparses);
+
+    for (j = 0; j < s->nparses; ++j) 
+      if (j != s->correct_index) {
+	Float score = parse_score(&s->parse[j], w);
+	Float margin = correct_score - score;
+	Float exp_nmargin;
+
+	if (score >= best_score) {     /* save best score */
+	  best_index = j;
+	  best_score = score;
+	}
 
-	  if (margin >= margin_cutoff) {
-	    exp_nmargin = exp(-margin);
-	    assert(finite(exp_nmargin));
-	    L += exp_nmargin;
-	    assert(finite(L));
-	  }
-	  else {
-	    exp_nmargin = exp(-margin_cutoff);
-	    assert(finite(exp_nmargin));
-	    L +=  (margin_cutoff+1-margin) * exp_nmargin;
-	    assert(finite(L));
-	  }
-	  sum_exp_nmargin += exp_nmargin;
-	  assert(finite(sum_exp_nmargin));
-	  for (k = 0; k < s->parse[j].nf; ++k)   /* 1 count features */
-	    dL_dw[s->parse[j].f[k]] += exp_nmargin;
-	  for (k = 0; k < s->parse[j].nfc; ++k)  /* arbitrary count features */
-	    dL_dw[s->parse[j].fc[k].f] += exp_nmargin * s->parse[j].fc[k].c;
+	if (margin >= margin_cutoff) {
+	  exp_nmargin = exp(-margin);
+	  assert(finite(exp_nmargin));
+	  L += exp_nmargin;
+	  assert(finite(L));
+	}
+	else {
+	  exp_nmargin = exp(-margin_cutoff);
+	  assert(finite(exp_nmargin));
+	  L +=  (margin_cutoff+1-margin) * exp_nmargin;
+	  assert(finite(L));
 	}
+	sum_exp_nmargin += exp_nmargin;
+	assert(finite(sum_exp_nmargin));
+	for (k = 0; k < s->parse[j].nf; ++k)   /* 1 count features */
+	  dL_dw[s->parse[j].f[k]] += exp_nmargin;
+	for (k = 0; k < s->parse[j].nfc; ++k)  /* arbitrary count features */
+	  dL_dw[s->parse[j].fc[k].f] += exp_nmargin * s->parse[j].fc[k].c;
+      }
       
-      for (k = 0; k < s->parse[s->correct_index].nf; ++k)
-	dL_dw[s->parse[s->correct_index].f[k]] -= sum_exp_nmargin;
-      for (k = 0; k < s->parse[s->correct_index].nfc; ++k)
-	dL_dw[s->parse[s->correct_index].fc[k].f] 
-	  -= sum_exp_nmargin * s->parse[s->correct_index].fc[k].c;
-
-      *sum_p += s->parse[best_index].p;
-      *sum_w += s->parse[best_index].w;
-    }
+    for (k = 0; k < s->parse[s->correct_index].nf; ++k)
+      dL_dw[s->parse[s->correct_index].f[k]] -= sum_exp_nmargin;
+    for (k = 0; k < s->parse[s->correct_index].nfc; ++k)
+      dL_dw[s->parse[s->correct_index].fc[k].f] 
+	-= sum_exp_nmargin * s->parse[s->correct_index].fc[k].c;
+
+    *sum_p += s->parse[best_index].p;
+    *sum_w += s->parse[best_index].w;
   }
-  assert(im == c->nloserparses);
   return L;
+}  /* exp_sentence_stats() */
+
+/*! exp_corpus_stats() returns the exp loss for the corpus
+ *! c, sets dL_dw[j] to the derivative of the log exp loss for feature
+ *! weight w[j], and sets the precision/recall statistics sum_g, sum_p
+ *! and sum_w.
+ */
+
+Float exp_corpus_stats(corpus_type *c, const Float w[], Float dL_dw[], 
+		       Float *sum_g, Float *sum_p, Float *sum_w)
+{
+  return sum_sentence_stats(c, exp_sentence_stats, w, dL_dw, sum_g, sum_p, sum_w);
 }  /* exp_corpus_stats() */
 
 
@@ -1209,21 +1693,58 @@ void fscore_sentence(sentence_type *s, const Float w[], Float Py_x[],
 Float fscore_corpus_stats(corpus_type *c, const Float w[], Float dFdw[],
 			  Float *sum_g, Float *sum_p, Float *sum_w)
 {
-  Float *Py_x = MALLOC(c->maxnparses*sizeof(Float));
   Float *sum_EDwf = CALLOC(c->nfeatures, sizeof(Float));
   Float *sum_EDpf = CALLOC(c->nfeatures, sizeof(Float));
-  Float E_w = 0, E_p = 0, D, F;
-  int i, j;
+  Float **thread_EDwf = thread_gradients();
+  Float **thread_EDpf = thread_gradients();
+  Float E_w = 0, E_p = 0, D, F, g = 0, p = 0, nw = 0;
+  int j;
 
-  assert(Py_x != NULL);
   assert(sum_EDwf != NULL);
   assert(sum_EDpf != NULL);
 
-  *sum_g = *sum_p = *sum_w = 0;          /* zero precision/recall counters */
-  for (i = 0; i < c->nsentences; ++i)    /* collect stats from sentences */
-    fscore_sentence(&c->sentence[i], w, Py_x, 
-		    &E_w, &E_p, sum_EDwf, sum_EDpf,
-		    sum_g, sum_p, sum_w);
+#ifdef _OPENMP
+# pragma omp parallel default(shared) reduction(+: E_w, E_p, g, p, nw)
+#endif
+  {
+    Float *local_EDwf = thread_gradient(thread_EDwf, sum_EDwf, c->nfeatures);
+    Float *local_EDpf = thread_gradient(thread_EDpf, sum_EDpf, c->nfeatures);
+    Float *Py_x = MALLOC(c->maxnparses*sizeof(Float));
+    Float *lw = MALLOC(c->maxnlf*sizeof(Float));
+    Float *lEDwf = MALLOC(c->maxnlf*sizeof(Float));
+    Float *lEDpf = MALLOC(c->maxnlf*sizeof(Float));
+    int i;
+
+    assert(Py_x != NULL);
+    assert(c->maxnlf == 0 || (lw != NULL && lEDwf != NULL && lEDpf != NULL));
+
+#ifdef _OPENMP
+# pragma omp for schedule(static)
+#endif
+    for (i = 0; i < c->nsentences; ++i) {  /* collect stats from sentences */
+      sentence_type *s = &c->sentence[i];
+      Float *sEDwf = sentence_gradient(s, local_EDwf, lEDwf);
+      Float *sEDpf = sentence_gradient(s, local_EDpf, lEDpf);
+      fscore_sentence(s, sentence_weights(s, w, lw), Py_x, 
+		      &E_w, &E_p, sEDwf, sEDpf,
+		      &g, &p, &nw);
+      add_sentence_gradient(s, sEDwf, local_EDwf);
+      add_sentence_gradient(s, sEDpf, local_EDpf);
+    }
+
+    FREE(lEDpf);
+    FREE(lEDwf);
+    FREE(lw);
+    FREE(Py_x);
+    reduce_thread_gradients(thread_EDwf, sum_EDwf, c->nfeatures);
+    reduce_thread_gradients(thread_EDpf, sum_EDpf, c->nfeatures);
+  }
+
+  FREE(thread_EDwf);
+  FREE(thread_EDpf);
+  *sum_g = g;
+  *sum_p = p;
+  *sum_w = nw;
 
   assert(finite(E_w));
   assert(finite(E_p));
@@ -1239,7 +1760,6 @@ Float fscore_corpus_stats(corpus_type *c, const Float w[], Float dFdw[],
     assert(finite(dFdw[j]));
   }
   
-  FREE(Py_x);
   FREE(sum_EDwf);
   FREE(sum_EDpf);
   return F;
@@ -1318,23 +1838,26 @@ Float ap_wd_featureweight(feature_type j, Float w[], Float weightdecay,
   return w[j] *= f;  /* return discounted weight */
 }  /* ap_wd_featureweight() */
 
-/*! ap_parse_wd_score() calculates the score for parse p, discounting
- *! the weight and updating the weight vector appropriately.
+/*! ap_parse_wd_score() calculates the score for parse p of sentence s,
+ *! discounting the weight and updating the weight vector appropriately.
  */
 
 __inline__ static
-Float ap_parse_wd_score(const parse_type *p, Float w[], Float weightdecay, 
+Float ap_parse_wd_score(const sentence_type *s, const parse_type *p, 
+			Float w[], Float weightdecay, 
 			Float sum_w[], size_type it, size_type changed[])
 {
   int i;
   Float score = 0;
   /* features with count of 1 */
   for (i = 0; i < p->nf; ++i)
-    score += ap_wd_featureweight(p->f[i], w, weightdecay, sum_w, it, changed);
+    score += ap_wd_featureweight(SENTENCE_FEATURE(s, p->f[i]), 
+				 w, weightdecay, sum_w, it, changed);
   /* features with arbitrary count */
   for (i = 0; i < p->nfc; ++i)
     score += p->fc[i].c 
-      * ap_wd_featureweight(p->fc[i].f, w, weightdecay, sum_w, it, changed);
+      * ap_wd_featureweight(SENTENCE_FEATURE(s, p->fc[i].f), 
+			    w, weightdecay, sum_w, it, changed);
   return score;
 }  /* ap_parse_wd_score() */
 
@@ -1354,14 +1877,14 @@ void ap_wd_sentence_scores(sentence_type *s, Float w[], Float weightdecay,
   *best_correct_i = -1;
 
   *best_score = sc 
-    = ap_parse_wd_score(&s->parse[0], w, weightdecay, sum_w, it, changed);
+    = ap_parse_wd_score(s, &s->parse[0], w, weightdecay, sum_w, it, changed);
   if (s->parse[0].Pyx > 0) {
     *best_correct_i = 0;
     *best_correct_score = sc;
   }
 
   for (i = 1; i < s->nparses; ++i) {
-    sc = ap_parse_wd_score(&s->parse[i], w, weightdecay, sum_w, it, changed);
+    sc = ap_parse_wd_score(s, &s->parse[i], w, weightdecay, sum_w, it, changed);
     if (sc >= *best_score) {
       *best_i = i;
       *best_score = sc;
@@ -1388,15 +1911,17 @@ void ap_wd_sentence_scores(sentence_type *s, Float w[], Float weightdecay,
  *!  sum_w      - cumulative sum of weight vectors
  *!  it         - current iteration
  *!  changed[k] - iteration at which w[k] was last changed
+ *!  lw         - scratch array of c->maxnlf weights for packed sentences
  */
 
 void ap_sentence(sentence_type *s, Float w[], Float dw, Float weightdecay,
-		 Float sum_w[], size_type it, size_type changed[])
+		 Float sum_w[], size_type it, size_type changed[], Float lw[])
 {
   Float best_correct_score, best_score;
   int best_i, best_correct_i;
   if (weightdecay == 0)
-    ap_sentence_scores(s, w, &best_correct_score, &best_correct_i, 
+    ap_sentence_scores(s, sentence_weights(s, w, lw), 
+		       &best_correct_score, &best_correct_i, 
 		       &best_score, &best_i);
   else
     ap_wd_sentence_scores(s, w, weightdecay, sum_w, it, changed,
@@ -1418,15 +1943,17 @@ void ap_sentence(sentence_type *s, Float w[], Float dw, Float weightdecay,
 
     /* subtract winner's feature counts */
     for (j = 0; j < winner->nf; ++j) 
-      ap_update1(winner->f[j], w, -dw, sum_w, it, changed);
+      ap_update1(SENTENCE_FEATURE(s, winner->f[j]), w, -dw, sum_w, it, changed);
     for (j = 0; j < winner->nfc; ++j)
-      ap_update1(winner->fc[j].f, w, -dw*winner->fc[j].c, sum_w, it, changed);
+      ap_update1(SENTENCE_FEATURE(s, winner->fc[j].f), w, -dw*winner->fc[j].c, 
+		 sum_w, it, changed);
 
     /* add correct's feature counts */
     for (j = 0; j < correct->nf; ++j)
-      ap_update1(correct->f[j], w, dw, sum_w, it, changed);
+      ap_update1(SENTENCE_FEATURE(s, correct->f[j]), w, dw, sum_w, it, changed);
     for (j = 0; j < correct->nfc; ++j)
-      ap_update1(correct->fc[j].f, w, dw*correct->fc[j].c, sum_w, it, changed);
+      ap_update1(SENTENCE_FEATURE(s, correct->fc[j].f), w, dw*correct->fc[j].c, 
+		 sum_w, it, changed);
   }
 }  /* ap_sentence() */
 
@@ -1441,15 +1968,17 @@ void ap_sentence(sentence_type *s, Float w[], Float dw, Float weightdecay,
  *!  sum_w      - cumulative sum of weight vectors
  *!  it         - current iteration
  *!  changed[k] - iteration at which w[k] was last changed
+ *!  lw         - scratch array of c->maxnlf weights for packed sentences
  */
 
 void wap_sentence(sentence_type *s, Float w[], 
 		  Float dw, const size_type feat_class[], const Float class_dw[],
-		  Float sum_w[], size_type it, size_type changed[])
+		  Float sum_w[], size_type it, size_type changed[], Float lw[])
 {
   Float best_correct_score, best_score;
   int best_correct_i = 0, best_i = 0;
-  ap_sentence_scores(s, w, &best_correct_score, &best_correct_i, &best_score, &best_i);
+  ap_sentence_scores(s, sentence_weights(s, w, lw), 
+		     &best_correct_score, &best_correct_i, &best_score, &best_i);
 
   if (best_correct_score <= best_score) { 
     /* update between parse[best_correct_i] and parse[best_i] */
@@ -1465,22 +1994,22 @@ void wap_sentence(sentence_type *s, Float w[],
 
     /* subtract winner's feature counts */
     for (j = 0; j < winner->nf; ++j) {
-      size_type f = winner->f[j];
+      size_type f = SENTENCE_FEATURE(s, winner->f[j]);
       ap_update1(f, w, -dw*class_dw[feat_class[f]], sum_w, it, changed);
     }
     for (j = 0; j < winner->nfc; ++j) {
-      size_type f = winner->fc[j].f;
+      size_type f = SENTENCE_FEATURE(s, winner->fc[j].f);
       ap_update1(f, w, -dw*winner->fc[j].c*class_dw[feat_class[f]], 
 		 sum_w, it, changed);
     }
 
     /* add correct's feature counts */
     for (j = 0; j < correct->nf; ++j) {
-      size_type f = correct->f[j];
+      size_type f = SENTENCE_FEATURE(s, correct->f[j]);
       ap_update1(f, w, dw*class_dw[feat_class[f]], sum_w, it, changed);
     }
     for (j = 0; j < correct->nfc; ++j) {
-      size_type f = correct->fc[j].f;
+      size_type f = SENTENCE_FEATURE(s, correct->fc[j].f);
       ap_update1(f, w, dw*correct->fc[j].c*class_dw[feat_class[f]], sum_w, it, changed);
     }
   }
@@ -1652,15 +2181,18 @@ Float lnn_corpus_stats(corpus_type *c, size_type nhidden,
 		       Float w[], Float dL_dw[],
 		       Float *sum_g, Float *sum_p, Float *sum_w) 
 {
-  lnn_weights_type wt, dL_dwt;
+  lnn_weights_type wt, dL_dwt, lwt, ldL_dwt;
   Float neglogP = 0;
   Float *score1 = MALLOC(c->maxnparses*sizeof(Float));
   Float *score0 = MALLOC(nhidden * c->maxnparses*sizeof(Float));
+  Float *lw0 = MALLOC(nhidden * c->maxnlf*sizeof(Float));
+  Float *ldL_dw0 = MALLOC(nhidden * c->maxnlf*sizeof(Float));
 
-  int i;
+  int i, j, k;
   
   assert(score1 != NULL);
   assert(score0 != NULL);
+  assert(c->maxnlf == 0 || (lw0 != NULL && ldL_dw0 != NULL));
 
   *sum_g = *sum_p = *sum_w = 0;          /* zero precision/recall counters */
 
@@ -1670,10 +2202,37 @@ Float lnn_corpus_stats(corpus_type *c, size_type nhidden,
   lnn_unpack_weights_type(w, nhidden, c->nfeatures, &wt);
   lnn_unpack_weights_type(dL_dw, nhidden, c->nfeatures, &dL_dwt);
 
-  for (i = 0; i < c->nsentences; ++i)  /* collect stats from sentences */
-    neglogP += lnn_sentence_stats(&c->sentence[i], &wt, nhidden, c->nfeatures, 
-				  score0, score1, &dL_dwt, sum_g, sum_p, sum_w);
+  /* a packed sentence is scored with level 0 weights lw0[nhidden][nlf] */
+
+  lwt = wt;
+  lwt.w0 = lw0;
+  ldL_dwt = dL_dwt;
+  ldL_dwt.w0 = ldL_dw0;
+
+  for (i = 0; i < c->nsentences; ++i) { /* collect stats from sentences */
+    sentence_type *s = &c->sentence[i];
+    size_type nlf = s->nlf;
+
+    if (s->lf == NULL) {
+      neglogP += lnn_sentence_stats(s, &wt, nhidden, c->nfeatures, 
+				    score0, score1, &dL_dwt, sum_g, sum_p, sum_w);
+      continue;
+    }
+
+    for (j = 0; j < nhidden; ++j)
+      for (k = 0; k < nlf; ++k) {
+	lw0[j*nlf+k] = wt.w0[j*c->nfeatures+s->lf[k]];
+	ldL_dw0[j*nlf+k] = 0;
+      }
+    neglogP += lnn_sentence_stats(s, &lwt, nhidden, nlf, 
+				  score0, score1, &ldL_dwt, sum_g, sum_p, sum_w);
+    for (j = 0; j < nhidden; ++j)
+      for (k = 0; k < nlf; ++k)
+	dL_dwt.w0[j*c->nfeatures+s->lf[k]] += ldL_dw0[j*nlf+k];
+  }
 
+  FREE(ldL_dw0);
+  FREE(lw0);
   FREE(score0);
   FREE(score1);
   return neglogP;
@@ -50,6 +50,7 @@ typedef float DataFloat;
 typedef struct {
   Float Pyx_factor;                    /* Pyx \propto factor ^ f-score */
   unsigned int Px_propto_g       : 1;  /* default is Px = 1 */
+  unsigned int packed            : 1;  /* pack_corpus() after reading */
 } corpusflags_type;
 
 typedef struct {
@@ -73,6 +74,8 @@ typedef struct {
   size_type    correct_index; /* index of correct parse, nparses when no correct parse */
   DataFloat    Px;            /* probability of this sentence, 0 when no correct parse */
   DataFloat    g;	      /* number of gold edges */
+  feature_type *lf;           /* features of a packed sentence, NULL when not packed */
+  size_type    nlf;           /* number of features in lf */
 } sentence_type;
 
 typedef struct {
@@ -81,23 +84,43 @@ typedef struct {
   size_type     nfeatures;    /* number of features */
   size_type	maxnparses;   /* maximum number of parses in a sentence */
   size_type	nloserparses; /* number of incorrect parses in all sentences */
+  size_type	maxnlf;       /* maximum nlf of a packed sentence, 0 when none are packed */
 } corpus_type;
 
 /*! max_score_index returns the index of the parse with the highest score in s */
 
 size_type max_score_index(const sentence_type *s, const Float w[]);
 
-/*! read_corpus() reads corpus from in. */
+/*! read_corpus() reads corpus from in, which may be in either the
+ *! text format or the binary format written by write_corpus_binary().
+ */
 
 corpus_type *read_corpus(corpusflags_type *flags, FILE *in);
 
 /*! read_corpus_file() reads corpus from the file named filename.  
- *! If the filename suffix ends in .bz2 it is popened with bzcat,
- *! if it ends in .gz it is popened with zcat.
+ *! If the filename suffix ends in .bz2 or .gz it is decompressed
+ *! in-process with libbz2 or zlib (see zfile.h).
  */
 
 corpus_type *read_corpus_file(corpusflags_type *flags, const char* filename);
 
+/*! write_corpus_binary() writes corpus c to out in a binary format
+ *! that read_corpus() maps into memory instead of parsing.
+ */
+
+void write_corpus_binary(const corpus_type *c, FILE *out);
+
+/*! pack_corpus() packs each sentence of c: s->lf[] is set to the
+ *! distinct features of s's parses, and the parses' f[] and fc[].f are
+ *! replaced by indices into s->lf[].  The functions below score the
+ *! parses of a packed sentence with a copy of just the weights of
+ *! its features, and accumulate the sentence's derivatives in a
+ *! correspondingly small array before adding them to dL_dw[].
+ *! read_corpus() packs the corpus when flags->packed is set.
+ */
+
+void pack_corpus(corpus_type *c);
+
 
 /***********************************************************************
  *                                                                     *
@@ -212,11 +235,12 @@ Float fscore_corpus_stats(corpus_type *c, const Float w[], Float dFdw[],
  *!  sum_w       - cumulative sum of weight vectors
  *!  it          - current iteration
  *!  changed[k]  - iteration at which w[k] was last changed
+ *!  lw          - scratch array of c->maxnlf weights for packed sentences
  */
 
 
 void ap_sentence(sentence_type *s, Float w[], Float dw, Float weightdecay,
-		 Float sum_w[], size_type it, size_type changed[]);
+		 Float sum_w[], size_type it, size_type changed[], Float lw[]);
 
 
 /*! wap_sentence() handles a single round of the weighted averaged perceptron.
@@ -229,11 +253,12 @@ void ap_sentence(sentence_type *s, Float w[], Float dw, Float weightdecay,
  *!  sum_w      - cumulative sum of weight vectors
  *!  it         - current iteration
  *!  changed[k] - iteration at which w[k] was last changed
+ *!  lw         - scratch array of c->maxnlf weights for packed sentences
  */
 
 void wap_sentence(sentence_type *s, Float w[], 
 		  Float dw, const size_type feat_class[], const Float class_dw[],
-		  Float sum_w[], size_type it, size_type changed[]);
+		  Float sum_w[], size_type it, size_type changed[], Float lw[]);
 
 
 /***********************************************************************
@@ -0,0 +1,110 @@
+// Licensed under the Apache License, Version 2.0 (the "License"); you may
+// not use this file except in compliance with the License.  You may obtain
+// a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations
+// under the License.
+
+// time-corpus-stats.cc
+//
+// time-corpus-stats times one evaluation of each of the *_corpus_stats()
+// loss functions on a corpus, i.e., the work done per optimizer
+// iteration, first on the corpus as read and then after pack_corpus().
+// lnn_corpus_stats() is run with a hidden layer of lnn_nhidden units.
+// The losses should be the same for the packed and unpacked corpus.
+// Run it with different values of OMP_NUM_THREADS to see how the
+// evaluations scale, e.g.
+//
+//   for t in 1 2 4 8 16 32; do 
+//     OMP_NUM_THREADS=$t time-corpus-stats train.lmb 
+//   done
+
+#include <cstdlib>
+#include <iostream>
+#include <sys/time.h>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "lmdata.h"
+
+static const size_type lnn_nhidden = 4;
+
+typedef Float (*corpus_stats_type)(corpus_type *c, const Float w[], Float dL_dw[], 
+				   Float *sum_g, Float *sum_p, Float *sum_w);
+
+static double now() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + 1e-6*tv.tv_usec;
+} // now()
+
+int main(int argc, char* argv[])
+{
+  if (argc < 2 || argc > 3) {
+    std::cerr << "Usage: " << argv[0] << " corpus [nevaluations]\n" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  int nevaluations = (argc == 3) ? atoi(argv[2]) : 5;
+
+  corpusflags_type cflags = { 0.0, 0 };
+  corpus_type* corpus = read_corpus_file(&cflags, argv[1]);
+
+  std::vector<Float> w(corpus->nfeatures), dL_dw(corpus->nfeatures);
+  srand(1);
+  for (size_type j = 0; j < corpus->nfeatures; ++j)
+    w[j] = 0.01 * (rand() / (RAND_MAX + 1.0) - 0.5);
+
+  size_type lnn_nw = lnn_nhidden * (corpus->nfeatures + 2);
+  std::vector<Float> lnn_w(lnn_nw), lnn_dL_dw(lnn_nw);
+  for (size_type j = 0; j < lnn_nw; ++j)
+    lnn_w[j] = 0.1 * (rand() / (RAND_MAX + 1.0) - 0.5);
+
+  static const struct { const char* name; corpus_stats_type fn; } losses[] = {
+    { "corpus_stats", corpus_stats },
+    { "emll_corpus_stats", emll_corpus_stats },
+    { "pwlog_corpus_stats", pwlog_corpus_stats },
+    { "exp_corpus_stats", exp_corpus_stats },
+    { "log_exp_corpus_stats", log_exp_corpus_stats },
+    { "fscore_corpus_stats", fscore_corpus_stats }
+  };
+
+#ifdef _OPENMP
+  int nthreads = omp_get_max_threads();
+#else
+  int nthreads = 1;
+#endif
+
+  std::cout << "# " << corpus->nsentences << " sentences, " << corpus->nfeatures
+	    << " features, " << nthreads << " threads" << std::endl
+	    << "# loss\tpacked\tseconds/evaluation\tL" << std::endl;
+
+  for (int packed = 0; packed <= 1; ++packed) {
+    if (packed)
+      pack_corpus(corpus);
+    for (size_t i = 0; i < sizeof(losses)/sizeof(losses[0]); ++i) {
+      Float sum_g, sum_p, sum_w, L = 0;
+      double start = now();
+      for (int n = 0; n < nevaluations; ++n)
+	L = losses[i].fn(corpus, &w[0], &dL_dw[0], &sum_g, &sum_p, &sum_w);
+      std::cout << losses[i].name << '\t' << packed 
+		<< '\t' << (now() - start) / nevaluations 
+		<< '\t' << L << std::endl;
+    }
+    Float sum_g, sum_p, sum_w, L = 0;
+    double start = now();
+    for (int n = 0; n < nevaluations; ++n)
+      L = lnn_corpus_stats(corpus, lnn_nhidden, &lnn_w[0], &lnn_dL_dw[0], 
+			   &sum_g, &sum_p, &sum_w);
+    std::cout << "lnn_corpus_stats" << '\t' << packed 
+	      << '\t' << (now() - start) / nevaluations 
+	      << '\t' << L << std::endl;
+  }
+} // main()
@@ -24,6 +24,7 @@
 #include <vector>
 
 #include "lmdata.h"
+#include "zfile.h"
 // #include "powell.h"
 #include "amoeba.h"
 #include "utility.h"
@@ -194,6 +195,8 @@ struct Estimator1 {
     assert(sum_w != NULL);
     size_type *changed = (size_type *) calloc(nfeatures, sizeof(size_type));
     assert(changed != NULL);
+    Float *lw = (Float *) malloc((train->maxnlf+1)*sizeof(Float));
+    assert(lw != NULL);
     
     size_type index;
     double rfactor = double(train->nsentences)/(RAND_MAX+1.0);
@@ -206,7 +209,7 @@ struct Estimator1 {
 	assert(index < train->nsentences);
 	if (train->sentence[index].Px > 0)
 	  wap_sentence(&train->sentence[index], w, dw, feat_class, class_factor,
-		       sum_w, it, changed);
+		       sum_w, it, changed, lw);
 	dw *= ddw;
       }
 
@@ -229,7 +232,7 @@ struct Estimator1 {
       dw *= ddw;
       if (train->sentence[index].Px > 0)
 	wap_sentence(&train->sentence[index], w, dw, feat_class, class_factor, 
-		     sum_w, it, changed);
+		     sum_w, it, changed, lw);
     }
     
     if (debug_level >= 1000)
@@ -245,6 +248,7 @@ struct Estimator1 {
     
     free(sum_w);
     free(changed);
+    free(lw);
   }  // Evaluate1::avper()
 
   // evaluate() evaluates the current model on the eval data, prints
@@ -325,32 +329,8 @@ struct Estimator1 {
 			   int nseparators = 1,
 			   const char* separators = ":") {
     
-    const char* filesuffix = strrchr(filename, '.');
-    bool popen_flag = false;
-    FILE *in;
-    if (strcasecmp(filesuffix, ".bz2") == 0) {
-      std::string command("bzcat ");
-      command += filename;
-      in = popen(command.c_str(), "r");
-      if (in == NULL) {
-	perror("## Error in cvlm: ");
-	std::cerr << "## popen(\"" << command << "\", \"r\") failed, usage = " << resource_usage() << std::endl;
-      }
-      popen_flag = true;
-    }
-    else if (strcasecmp(filesuffix, ".gz") == 0) {
-      std::string command("gunzip -c ");
-      command += filename;
-      errno = 0;
-      in = popen(command.c_str(), "r");
-      if (in == NULL) {
-	perror("## Error in cvlm: ");
-	std::cerr << "## popen(\"" << command << "\", \"r\") failed, usage = " << resource_usage() << std::endl;
-      }
-      popen_flag = true;
-    }
-    else
-      in = fopen(filename, "r");
+    errno = 0;
+    FILE *in = zfopen(filename, "r");
     if (in == NULL) {
       std::cerr << "## Couldn't open evalfile " << filename
 		<< ", errno = " << errno << "\n" 
@@ -423,10 +403,7 @@ struct Estimator1 {
     if (debug_level >= 0) 
       std::cerr << "# Regularization classes: " << regclass_identifiers << std::endl;
 
-    if (popen_flag)
-      pclose(in);
-    else
-      fclose(in);
+    fclose(in);
   }  // Estimator1::read_featureclasses()
     
   void estimate()
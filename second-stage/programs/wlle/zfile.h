@@ -0,0 +1 @@
+../features/zfile.h
\ No newline at end of file
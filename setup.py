@@ -97,8 +97,9 @@ parser_sources = (wrapper_path, 'Bchart.C', 'BchartSm.C', 'Bst.C',
                   'ClassRule.C', 'ECArgs.C', 'Edge.C', 'EdgeHeap.C',
                   'ExtPos.C', 'Feat.C', 'Feature.C', 'FeatureTree.C',
                   'Field.C', 'FullHist.C', 'GotIter.C', 'InputTree.C',
-                  'Item.C', 'Link.C', 'Params.C', 'ParseStats.C',
-                  'SentRep.C', 'ScoreTree.C', 'Term.C', 'TimeIt.C',
+                  'Item.C', 'Link.C', 'ModelImage.C', 'Params.C',
+                  'ParseArena.C', 'ParserContext.C', 'ParseStats.C',
+                  'ProbCache.C', 'SentRep.C', 'ScoreTree.C', 'Term.C', 'TimeIt.C',
                   'UnitRules.C', 'ValHeap.C', 'edgeSubFns.C',
                   'ewDciTokStrm.C', 'extraMain.C', 'fhSubFns.C',
                   'headFinder.C', 'headFinderCh.C', 'utils.C',
@@ -107,7 +108,7 @@ parser_sources = [join(parser_base, src) for src in parser_sources]
 
 parser_module = Extension('bllipparser._CharniakParser',
                           sources=parser_sources, include_dirs=[parser_base],
-                          libraries=['stdc++'])
+                          libraries=['stdc++', 'pthread'])
 
 #
 # reranker wrapper
@@ -132,8 +133,11 @@ reranker_sources = [join(reranker_base, src) for src in
 
 reranker_module = Extension('bllipparser._JohnsonReranker',
                             sources=reranker_sources,
+                            libraries=['z', 'bz2'],
                             extra_compile_args=['-iquote', reranker_base,
-                                                '-DSWIGFIX'])
+                                                '-iquote', parser_base,
+                                                '-DSWIGFIX', '-fopenmp'],
+                            extra_link_args=['-fopenmp'])
 
 setup(name='bllipparser',
       version='2015.12.3',